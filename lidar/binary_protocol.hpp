@@ -0,0 +1,199 @@
+#pragma once
+
+// binary_protocol.hpp — binární rámcový režim TCP služby (port 9002)
+// ---------------------------------------------------------------------------
+// • Vyjednává se pro každé spojení textovým příkazem "BINARY <verze>";
+//   server odpoví "OK BINARY <v>" (v = min(klient, kVersion)) a od dalšího
+//   bajtu jsou oba směry jen rámce. Textový režim zůstává výchozí.
+// • Rámec = FrameHeader (24 B, little endian) + length bajtů payloadu.
+//     seq  – pořadí rámce v daném směru spojení (od 1),
+//     ref  – seq požadavku, na který rámec odpovídá (0 = push, např. Cloud),
+//     stamp_ns – monotonic čas (steady_clock) odeslání, stejné hodiny jako
+//                CloudFrameHeader::stamp_ns a ShmHeader::stamp_ns.
+// • Payloady (MsgType):
+//     Text       – textový příkaz / textová odpověď bez '\n' (všechny příkazy
+//                  kromě EXIT, SHUTDOWN, SUBSCRIBE, BINARY),
+//     Corridors, Objects, Tracks – ListHeader + pole struktur (Corridor,
+//                  ObstacleObject, TrackedObject) tak, jak leží v paměti,
+//     Grid       – EgoOccupancyGrid::Meta + hits       (= /robot_lidar_grid),
+//     HeightMap  – HeightMap::Meta + z_min|z_max|z_mean (= /robot_lidar_heightmap),
+//     Clearance  – EgoOccupancyGrid::Meta + float[kCells] (= /robot_lidar_clearance),
+//     SubscribeCloud – požadavek: uint16 voxel_cm (0 = odhlásit); odpověď
+//                  prázdná, pak push rámce Cloud = CloudFrameHeader + body.
+//   Prázdný payload odpovědi = data zatím nejsou, Error = text chyby.
+// • FrameWriter posílá hlavičku a payload jedním sendmsg() se scatter/gather
+//   vektorem přímo z publikovaných snapshotů (shared_ptr<const>, drží se po
+//   dobu odeslání) – žádné skládání stringů ani kopie payloadu.
+// • FrameReader skládá rámce z přijatých bajtů; větší požadavek než
+//   kMaxRequestBytes = chyba protokolu (spojení se zavře).
+// ---------------------------------------------------------------------------
+
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+enum class MsgType : std::uint16_t {
+    Text           = 0x01,
+    Error          = 0x02,
+    Corridors      = 0x10,
+    Objects        = 0x11,
+    Tracks         = 0x12,
+    Grid           = 0x13,
+    HeightMap      = 0x14,
+    Clearance      = 0x15,
+    SubscribeCloud = 0x20,
+    Cloud          = 0x21,
+};
+
+struct FrameHeader
+{
+    std::uint32_t length;       // bajty payloadu za hlavičkou
+    std::uint16_t type;         // MsgType
+    std::uint16_t version;      // verze protokolu spojení
+    std::uint32_t seq;
+    std::uint32_t ref;
+    std::uint64_t stamp_ns;
+};
+
+// Hlavička seznamových payloadů (Corridors, Objects, Tracks).
+struct ListHeader
+{
+    std::uint64_t rev;
+    std::uint32_t n;
+    std::uint16_t item_bytes;   // sizeof položky – klient pozná změnu struktury
+    std::uint16_t reserved;
+};
+
+static_assert(sizeof(FrameHeader) == 24, "FrameHeader must be 24 bytes");
+static_assert(sizeof(ListHeader) == 16, "ListHeader must be 16 bytes");
+
+namespace binproto {
+
+constexpr std::uint16_t kVersion = 1;
+constexpr std::uint32_t kMaxRequestBytes = 64 * 1024;
+
+inline std::uint64_t monotonicNs()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace binproto
+
+class FrameWriter
+{
+public:
+    static constexpr int kMaxParts = 7;
+
+    FrameWriter(int sock, std::uint16_t version) : sock_(sock), version_(version) {}
+
+    // Rámec z částí payloadu (ukazatele musí platit do návratu).
+    bool send(MsgType type, std::uint32_t ref, std::initializer_list<iovec> parts)
+    {
+        iovec iov[kMaxParts + 1];
+        int cnt = 1;
+        std::size_t len = 0;
+        for (const iovec &p : parts) {
+            if (cnt > kMaxParts) return false;
+            if (p.iov_len == 0) continue;
+            iov[cnt++] = p;
+            len += p.iov_len;
+        }
+        FrameHeader h{static_cast<std::uint32_t>(len), static_cast<std::uint16_t>(type),
+                      version_, ++seq_, ref, binproto::monotonicNs()};
+        iov[0] = iovec{&h, sizeof(h)};
+        return sendAll(iov, cnt);
+    }
+
+    bool sendText(MsgType type, std::uint32_t ref, const std::string &text)
+    {
+        return send(type, ref, {part(text.data(), text.size())});
+    }
+
+    // ListHeader + pole POD struktur přímo z vektoru snapshotu.
+    template <typename T>
+    bool sendList(MsgType type, std::uint32_t ref, std::uint64_t rev, const std::vector<T> &items)
+    {
+        const ListHeader lh{rev, static_cast<std::uint32_t>(items.size()),
+                            static_cast<std::uint16_t>(sizeof(T)), 0};
+        return send(type, ref, {part(&lh, sizeof(lh)), part(items.data(), items.size() * sizeof(T))});
+    }
+
+    static iovec part(const void *p, std::size_t n)
+    {
+        return iovec{const_cast<void *>(p), n};
+    }
+
+private:
+    // sendmsg() může odeslat jen část – posun ve vektoru a pokračování.
+    bool sendAll(iovec *iov, int cnt)
+    {
+        while (cnt > 0) {
+            msghdr m{};
+            m.msg_iov = iov;
+            m.msg_iovlen = static_cast<std::size_t>(cnt);
+            ssize_t n = ::sendmsg(sock_, &m, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            auto left = static_cast<std::size_t>(n);
+            while (cnt > 0 && left >= iov->iov_len) {
+                left -= iov->iov_len;
+                ++iov;
+                --cnt;
+            }
+            if (cnt > 0) {
+                iov->iov_base = static_cast<std::uint8_t *>(iov->iov_base) + left;
+                iov->iov_len -= left;
+            }
+        }
+        return true;
+    }
+
+    int           sock_;
+    std::uint16_t version_;
+    std::uint32_t seq_ = 0;
+};
+
+class FrameReader
+{
+public:
+    void append(const char *data, std::size_t n) { buf_.append(data, n); }
+
+    // Další celý rámec; false = čeká se na data. bad() = porušený protokol.
+    bool next(FrameHeader &h, std::string &payload)
+    {
+        if (bad_) return false;
+        if (buf_.size() - pos_ < sizeof(FrameHeader)) {
+            buf_.erase(0, pos_);
+            pos_ = 0;
+            return false;
+        }
+        std::memcpy(&h, buf_.data() + pos_, sizeof(h));
+        if (h.length > binproto::kMaxRequestBytes) {
+            bad_ = true;
+            return false;
+        }
+        if (buf_.size() - pos_ < sizeof(h) + h.length) {
+            buf_.erase(0, pos_);
+            pos_ = 0;
+            return false;
+        }
+        payload.assign(buf_, pos_ + sizeof(h), h.length);
+        pos_ += sizeof(h) + h.length;
+        return true;
+    }
+
+    bool bad() const { return bad_; }
+
+private:
+    std::string buf_;
+    std::size_t pos_ = 0;
+    bool        bad_ = false;
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+// black_box.hpp — "černá skříňka": posledních N sekund dat v RAM
+// ---------------------------------------------------------------------------
+// • BlackBoxRecorder drží kruhový buffer záznamů ve tvaru L2RAW01
+//   (LogRecordHeader + payload) v pevně předalokované paměti:
+//     kRingBytes bajtů dat + kMaxRecords popisovačů {ts, offset, size}.
+//   Záznam se nikdy nerozdělí – když se nevejde na konec, zápis pokračuje
+//   od začátku (konec bufferu zůstane nevyužitý). Nejstarší záznamy se
+//   přepisují, nic se nealokuje.
+// • record(): syrové pakety (Point / IMU / VERSION), annotate(): textové
+//   výsledky zpracování (RawRecordType::Annotation – koridory, objekty,
+//   tracky za otáčku, událost TRIGGER). Obojí jen z vlákna loopRead, zápis
+//   do ringu pod krátkým zámkem (sdílí ho vlákno zapisovače).
+// • trigger(reason): z libovolného vlákna (TCP TRIGGER, narušení bezpečné
+//   zóny) otevře okno = kPreNs před událostí + kPostNs po ní (monotonic
+//   čas, stejné hodiny jako mono_ts_ns paketů). Okno zavírá vlákno
+//   zapisovače na časovač (wait_until konce okna) – nezávisle na tom, jestli
+//   ještě chodí pakety (porucha LiDARu, odpojený kabel). Zkopíruje okno
+//   (max. dva souvislé úseky → dvě memcpy) do persist bufferu a uloží ho jako
+//       <base_dir>/<YYYY-MM-DD>/blackbox-HH-MM-SS.dat (+ .idx, L2RAW03)
+//   – čtou ho stejné nástroje jako běžný raw log (raw_log_reader, convert).
+// • Během otevřeného okna se další trigger jen započítá (merged); okno
+//   otevřené během ukládání předchozího se zavře hned po něm.
+// • flush() (LidarController::stop) a destruktor uloží otevřené okno hned,
+//   s tím, co v ringu je – incident před STOP / SHUTDOWN se neztratí.
+// • Stačí pro incidenty i při vypnutém průběžném logu (TCP RAWLOG OFF).
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raw_log_format.hpp"
+#include "raw_logger.hpp"     // writeRawLogFile, LidarRawLogger::makeDefaultPath
+#include "stage_stats.hpp"
+
+class BlackBoxRecorder
+{
+public:
+    static constexpr std::size_t   kRingBytes = 8u << 20;        // ~35 s point paketů (okno 25 s + rezerva)
+    static constexpr std::size_t   kMaxRecords = 1u << 16;
+    static constexpr std::size_t   kPersistBytes = 8u << 20;     // max. velikost okna
+    static constexpr std::uint64_t kPreNs = 20000000000ull;      // před událostí
+    static constexpr std::uint64_t kPostNs = 5000000000ull;      // po události
+
+    explicit BlackBoxRecorder(const std::string &base_dir = "/data/robot/lidar")
+        : base_dir_(base_dir),
+          ring_(new uint8_t[kRingBytes]),
+          persist_(new uint8_t[kPersistBytes]),
+          slots_(kMaxRecords)
+    {
+        // page faulty teď, ne v loopRead
+        std::memset(ring_.get(), 0, kRingBytes);
+        std::memset(persist_.get(), 0, kPersistBytes);
+        worker_ = std::thread(&BlackBoxRecorder::loop, this);
+    }
+
+    ~BlackBoxRecorder()
+    {
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) worker_.join();   // uloží i otevřené okno
+    }
+
+    BlackBoxRecorder(const BlackBoxRecorder &) = delete;
+    BlackBoxRecorder &operator=(const BlackBoxRecorder &) = delete;
+
+    // Paket z LiDARu (jen vlákno loopRead); velikost podle header.packet_size.
+    template <typename Packet>
+    void recordPacket(RawRecordType type, const Packet &pkt, uint64_t mono_ts_ns)
+    {
+        if (pkt.header.packet_size == 0 || pkt.header.packet_size > sizeof(pkt)) return;
+        record(type, &pkt, pkt.header.packet_size, mono_ts_ns);
+    }
+
+    // Textový záznam (jen vlákno loopRead).
+    void annotate(uint64_t mono_ts_ns, const std::string &text)
+    {
+        const std::size_t n = std::min<std::size_t>(text.size(), rawlog::kMaxPayload);
+        record(RawRecordType::Annotation, text.data(), static_cast<uint32_t>(n), mono_ts_ns);
+    }
+
+    void record(RawRecordType type, const void *data, uint32_t size, uint64_t mono_ts_ns)
+    {
+        if (size == 0 || size > rawlog::kMaxPayload) return;
+        std::lock_guard<std::mutex> lg(mtx_);
+        append(type, data, size, mono_ts_ns);
+    }
+
+    // Událost k uložení (libovolné vlákno). false = okno už je otevřené
+    // (událost patří k němu).
+    bool trigger(const std::string &reason)
+    {
+        triggers_.fetch_add(1, std::memory_order_relaxed);
+        const uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            if (open_) {
+                merged_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            open_ = true;
+            trigger_ts_ = now;
+            const std::string text = "TRIGGER " + reason;
+            append(RawRecordType::Annotation, text.data(),
+                   static_cast<uint32_t>(std::min<std::size_t>(text.size(), rawlog::kMaxPayload)), now);
+        }
+        cv_.notify_all();
+        return true;
+    }
+
+    // Otevřené okno uložit hned (neblokuje ingest, čeká na zápis souboru).
+    void flush()
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (!open_ && !writing_) return;
+        flush_ = true;
+        cv_.notify_all();
+        cv_.wait(lk, [this] { return !open_ && !writing_; });
+        flush_ = false;
+    }
+
+    std::string lastPath() const
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        return last_path_;
+    }
+
+    // "<name> records=.. span_ms=.. triggers=.. merged=.. saved=.. truncated=.. errors=.. last=.."
+    std::string toString(const char *name) const
+    {
+        std::ostringstream os;
+        const std::string last = lastPath();
+        os << name
+           << " records=" << records_.load(std::memory_order_relaxed)
+           << " span_ms=" << span_ns_.load(std::memory_order_relaxed) / 1000000ull
+           << " triggers=" << triggers_.load(std::memory_order_relaxed)
+           << " merged=" << merged_.load(std::memory_order_relaxed)
+           << " saved=" << saved_.load(std::memory_order_relaxed)
+           << " truncated=" << truncated_.load(std::memory_order_relaxed)
+           << " errors=" << errors_.load(std::memory_order_relaxed)
+           << " last=" << (last.empty() ? "-" : last);
+        const std::string n(name);
+        return os.str() + " | " + copy_stats_.toString((n + "_copy").c_str()) +
+               " | " + write_stats_.toString((n + "_write").c_str());
+    }
+
+private:
+    struct Slot {
+        uint64_t ts;
+        uint32_t off;
+        uint32_t size;
+    };
+
+    // Záznam do ringu (pod mtx_).
+    void append(RawRecordType type, const void *data, uint32_t size, uint64_t mono_ts_ns)
+    {
+        const std::size_t rec = sizeof(LogRecordHeader) + size;
+        if (write_off_ + rec > kRingBytes) {
+            evict(write_off_, kRingBytes);     // nevyužitý konec bufferu
+            tail_end_ = write_off_;
+            write_off_ = 0;
+        }
+        if (count_ == kMaxRecords) pop();
+        evict(write_off_, write_off_ + rec);
+
+        LogRecordHeader hdr{};
+        hdr.type = static_cast<uint8_t>(type);
+        hdr.mono_ts_ns = mono_ts_ns;
+        hdr.payload_size = size;
+        std::memcpy(ring_.get() + write_off_, &hdr, sizeof(hdr));
+        std::memcpy(ring_.get() + write_off_ + sizeof(hdr), data, size);
+        slots_[(head_ + count_) % kMaxRecords] = Slot{mono_ts_ns, static_cast<uint32_t>(write_off_),
+                                                      static_cast<uint32_t>(rec)};
+        ++count_;
+        write_off_ += rec;
+        records_.fetch_add(1, std::memory_order_relaxed);
+        span_ns_.store(mono_ts_ns - slots_[head_].ts, std::memory_order_relaxed);
+    }
+
+    void pop()
+    {
+        head_ = (head_ + 1) % kMaxRecords;
+        --count_;
+    }
+
+    // Uvolní nejstarší záznamy zasahující do [from, to). Živé záznamy leží
+    // kruhově za write_off_ v pořadí stáří → stačí kontrolovat nejstarší.
+    void evict(std::size_t from, std::size_t to)
+    {
+        while (count_ > 0) {
+            const Slot &s = slots_[head_];
+            if (s.off >= to || s.off + s.size <= from) break;
+            pop();
+        }
+    }
+
+    // Okno [trigger - kPreNs, trigger + kPostNs] → persist_ (pod mtx_).
+    // Vrací velikost dat, 0 = okno je prázdné.
+    std::size_t copyWindow()
+    {
+        const uint64_t from_ts = trigger_ts_ > kPreNs ? trigger_ts_ - kPreNs : 0;
+        const uint64_t to_ts = trigger_ts_ + kPostNs;
+
+        // od nejnovějšího zpět: nejdřív přeskočit záznamy po konci okna
+        // (zavřeno pozdě), pak brát, dokud sedí čas a velikost
+        std::size_t last = count_;
+        while (last > 0 && slots_[(head_ + last - 1) % kMaxRecords].ts > to_ts) --last;
+        std::size_t first = last, bytes = 0;
+        while (first > 0) {
+            const Slot &s = slots_[(head_ + first - 1) % kMaxRecords];
+            if (s.ts < from_ts) break;
+            if (bytes + s.size > kPersistBytes) {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            bytes += s.size;
+            --first;
+        }
+        if (first == last) return 0;
+
+        StageTimer t(copy_stats_, bytes);
+        const std::size_t start = slots_[(head_ + first) % kMaxRecords].off;
+        const Slot &end_slot = slots_[(head_ + last - 1) % kMaxRecords];
+        const std::size_t end = end_slot.off + end_slot.size;
+        if (start < end) {
+            std::memcpy(persist_.get(), ring_.get() + start, end - start);
+            return end - start;
+        }
+        // okno přes konec bufferu (nejvýš jednou – okno je kratší než buffer)
+        std::memcpy(persist_.get(), ring_.get() + start, tail_end_ - start);
+        std::memcpy(persist_.get() + (tail_end_ - start), ring_.get(), end);
+        return tail_end_ - start + end;
+    }
+
+    // Vlákno zapisovače: na konci okna (nebo flush / stop) okno zkopíruje
+    // a uloží jako blackbox-HH-MM-SS.dat.
+    void loop()
+    {
+        using namespace std::chrono;
+        std::unique_lock<std::mutex> lk(mtx_);
+        for (;;) {
+            if (!open_) {
+                if (stop_) break;
+                cv_.wait(lk, [this] { return stop_ || open_; });
+                continue;
+            }
+            const steady_clock::time_point deadline{nanoseconds(trigger_ts_ + kPostNs)};
+            if (!cv_.wait_until(lk, deadline, [this] { return stop_ || flush_; }) &&
+                steady_clock::now() < deadline) {
+                continue;   // falešné probuzení
+            }
+
+            open_ = false;
+            const std::size_t size = copyWindow();
+            writing_ = true;
+            lk.unlock();
+
+            if (size > 0) save(size);
+
+            lk.lock();
+            writing_ = false;
+            cv_.notify_all();   // flush()
+        }
+    }
+
+    void save(std::size_t size)
+    {
+        std::string path, err;
+        bool ok = false;
+        {
+            StageTimer t(write_stats_, size);
+            try {
+                path = LidarRawLogger::makeDefaultPath(base_dir_, "blackbox-");
+                ok = writeRawLogFile(path, persist_.get(), size, &err);
+            } catch (const std::exception &e) {
+                err = e.what();
+            }
+        }
+        if (ok) {
+            saved_.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lg(mtx_);
+            last_path_ = path;
+        } else {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "[blackbox] " << err << std::endl;
+        }
+    }
+
+    std::string base_dir_;
+    std::unique_ptr<uint8_t[]> ring_;
+    std::unique_ptr<uint8_t[]> persist_;
+
+    // kruhový buffer a okno (pod mtx_; persist_ jen zapisovač)
+    std::vector<Slot> slots_;
+    std::size_t head_ = 0;         // nejstarší popisovač
+    std::size_t count_ = 0;
+    std::size_t write_off_ = 0;
+    std::size_t tail_end_ = 0;     // konec dat před posledním přetočením
+    bool        open_ = false;     // okno čeká na kPostNs
+    uint64_t    trigger_ts_ = 0;   // monotonic [ns]
+    bool        writing_ = false;  // zapisovač ukládá persist_
+    bool        flush_ = false;    // zavřít okno hned (flush)
+    bool        stop_ = false;
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::string             last_path_;
+    std::thread             worker_;
+
+    std::atomic<std::uint64_t> records_{0};
+    std::atomic<std::uint64_t> span_ns_{0};
+    std::atomic<std::uint64_t> triggers_{0};
+    std::atomic<std::uint64_t> merged_{0};
+    std::atomic<std::uint64_t> saved_{0};
+    std::atomic<std::uint64_t> truncated_{0};
+    std::atomic<std::uint64_t> errors_{0};
+    StageStats copy_stats_;
+    StageStats write_stats_;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+// cloud_stream.hpp — náhledový stream cloudu pro webové UI
+// ---------------------------------------------------------------------------
+// • CloudSnapshot: body poslední celé otáčky z range image (řádky s rev dané
+//   otáčky, platné buňky), rámec robota [cm]. Staví se v onRevolution() jen
+//   když je aspoň jeden odběratel, publikuje se jako shared_ptr<const>.
+// • VoxelDownsampler: jeden na odběratele (klientské vlákno), velikost voxelu
+//   si volí klient. Voxely v hashovací tabulce s otevřeným adresováním
+//   (klíč = 3 × 21 bitů indexu voxelu), tabulka i akumulátory se recyklují
+//   mezi otáčkami → bez alokací v ustáleném stavu.
+//   Voxel = těžiště bodů, průměrná intenzita, "nejhorší" label
+//   (negativní > překážka > země > ostatní).
+// • Rámec: CloudFrameHeader (40 B, little endian) + n_points × CloudPoint16
+//   (int16 x, y, z [cm] → rozsah ±327 m, uint8 intensity, uint8 label).
+//   Při voxelu 10 cm je to typicky pár tisíc bodů na otáčku, tj. stovky KB/s.
+// • CloudStreamStats: cena stavby snapshotu a voxelizace + počty pro TCP STATS.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "range_image.hpp"
+#include "ground_segmentation.hpp"
+#include "stage_stats.hpp"
+
+struct CloudSnapshot
+{
+    struct Point {
+        float x, y, z;              // rámec robota [cm]
+        std::uint8_t intensity;
+        std::uint8_t label;         // GroundSegmentation::Label
+    };
+
+    std::uint64_t      rev = 0;        // jako u ostatních výsledků otáčky
+    std::uint64_t      stamp_ns = 0;   // monotonic čas konce otáčky
+    std::vector<Point> points;
+
+    // Platné buňky řádků s Row::rev == row_rev.
+    void build(const RangeImage &img, std::uint32_t row_rev)
+    {
+        points.clear();
+        for (int r = 0; r < RangeImage::kRows; ++r) {
+            const RangeImage::Row &row = img.row(r);
+            if (row.rev != row_rev || row.stamp < 0.0) continue;
+            const RangeImage::Cell *c = img.rowData(r);
+            for (int j = 0; j < row.n; ++j) {
+                if (!c[j].valid()) continue;
+                points.push_back(Point{c[j].x, c[j].y, c[j].z, c[j].intensity, c[j].label});
+            }
+        }
+    }
+};
+
+struct CloudFrameHeader
+{
+    char          magic[4];         // "L2CF"
+    std::uint16_t version;          // kVersion
+    std::uint16_t header_bytes;     // sizeof(CloudFrameHeader)
+    std::uint32_t payload_bytes;    // n_points × point_bytes
+    std::uint32_t rev;              // pořadí otáčky
+    std::uint64_t stamp_ns;         // monotonic čas konce otáčky
+    std::uint16_t voxel_cm;
+    std::uint16_t point_bytes;      // sizeof(CloudPoint16)
+    std::uint32_t n_points;         // po voxelizaci
+    std::uint32_t n_source;         // před voxelizací
+    std::uint32_t reserved;
+};
+
+struct CloudPoint16
+{
+    std::int16_t x, y, z;           // [cm]
+    std::uint8_t intensity;
+    std::uint8_t label;
+};
+
+static_assert(sizeof(CloudFrameHeader) == 40, "CloudFrameHeader must be 40 bytes");
+static_assert(sizeof(CloudPoint16) == 8, "CloudPoint16 must be 8 bytes");
+
+struct CloudStreamStats
+{
+    std::atomic<std::uint32_t> subscribers{0};
+    std::atomic<std::uint64_t> frames{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> skipped{0};     // otáčky, které pomalý klient nestihl
+    StageStats build;                          // loopRead
+    StageStats voxel;                          // klientská vlákna (orientačně)
+
+    // "<name> subscribers=.. frames=.. kb=.. skipped=.. | <name>_build .. | <name>_voxel .."
+    std::string toString(const char *name) const
+    {
+        std::ostringstream os;
+        os << name
+           << " subscribers=" << subscribers.load(std::memory_order_relaxed)
+           << " frames=" << frames.load(std::memory_order_relaxed)
+           << " kb=" << bytes.load(std::memory_order_relaxed) / 1024
+           << " skipped=" << skipped.load(std::memory_order_relaxed);
+        const std::string n(name);
+        return os.str() + " | " + build.toString((n + "_build").c_str()) + " | " +
+               voxel.toString((n + "_voxel").c_str());
+    }
+};
+
+class VoxelDownsampler
+{
+public:
+    static constexpr char          kMagic[4] = {'L', '2', 'C', 'F'};
+    static constexpr std::uint16_t kVersion = 1;
+    static constexpr unsigned      kMinVoxelCm = 2;
+    static constexpr unsigned      kMaxVoxelCm = 200;
+    static constexpr unsigned      kDefaultVoxelCm = 10;
+
+    explicit VoxelDownsampler(unsigned voxel_cm = kDefaultVoxelCm)
+        : voxel_cm_(std::clamp(voxel_cm, kMinVoxelCm, kMaxVoxelCm)),
+          inv_voxel_(1.0f / static_cast<float>(voxel_cm_)) {}
+
+    unsigned voxelCm() const { return voxel_cm_; }
+
+    // Snapshot → hotový rámec (hlavička + body) v out; vrací počet voxelů.
+    std::size_t run(const CloudSnapshot &s, std::vector<std::uint8_t> &out)
+    {
+        const std::size_t n = s.points.size();
+        std::size_t cap = 1024;
+        unsigned bits = 10;
+        while (cap < 2 * n) { cap <<= 1; ++bits; }
+        slots_.resize(cap);
+        shift_ = 64 - bits;
+        std::fill(slots_.begin(), slots_.end(), kEmpty);
+        voxels_.clear();
+
+        const std::size_t mask = cap - 1;
+        for (const CloudSnapshot::Point &p : s.points) {
+            const std::uint64_t key = keyOf(p);
+            std::size_t h = static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+            for (;; h = (h + 1) & mask) {
+                const std::uint32_t v = slots_[h];
+                if (v == kEmpty) {
+                    slots_[h] = static_cast<std::uint32_t>(voxels_.size());
+                    voxels_.push_back(Voxel{key, p.x, p.y, p.z, 1, p.intensity, p.label});
+                    break;
+                }
+                Voxel &vx = voxels_[v];
+                if (vx.key == key) {
+                    vx.sx += p.x;
+                    vx.sy += p.y;
+                    vx.sz += p.z;
+                    ++vx.n;
+                    vx.isum += p.intensity;
+                    if (rank(p.label) > rank(vx.label)) vx.label = p.label;
+                    break;
+                }
+            }
+        }
+
+        const std::size_t m = voxels_.size();
+        out.resize(sizeof(CloudFrameHeader) + m * sizeof(CloudPoint16));
+
+        CloudFrameHeader hdr{};
+        std::memcpy(hdr.magic, kMagic, sizeof(hdr.magic));
+        hdr.version       = kVersion;
+        hdr.header_bytes  = sizeof(CloudFrameHeader);
+        hdr.payload_bytes = static_cast<std::uint32_t>(m * sizeof(CloudPoint16));
+        hdr.rev           = static_cast<std::uint32_t>(s.rev);
+        hdr.stamp_ns      = s.stamp_ns;
+        hdr.voxel_cm      = static_cast<std::uint16_t>(voxel_cm_);
+        hdr.point_bytes   = sizeof(CloudPoint16);
+        hdr.n_points      = static_cast<std::uint32_t>(m);
+        hdr.n_source      = static_cast<std::uint32_t>(n);
+        std::memcpy(out.data(), &hdr, sizeof(hdr));
+
+        CloudPoint16 *dst = reinterpret_cast<CloudPoint16 *>(out.data() + sizeof(hdr));
+        for (std::size_t i = 0; i < m; ++i) {
+            const Voxel &v = voxels_[i];
+            const float inv = 1.0f / static_cast<float>(v.n);
+            dst[i] = CloudPoint16{quantize(v.sx * inv), quantize(v.sy * inv), quantize(v.sz * inv),
+                                  static_cast<std::uint8_t>(v.isum / v.n), v.label};
+        }
+        return m;
+    }
+
+private:
+    static constexpr std::uint32_t kEmpty = 0xFFFFFFFFu;
+
+    struct Voxel {
+        std::uint64_t key;
+        float         sx, sy, sz;
+        std::uint32_t n;
+        std::uint32_t isum;
+        std::uint8_t  label;
+    };
+
+    std::uint64_t keyOf(const CloudSnapshot::Point &p) const
+    {
+        constexpr std::uint64_t k21 = (1u << 21) - 1;
+        const auto ix = static_cast<std::int64_t>(std::floor(p.x * inv_voxel_));
+        const auto iy = static_cast<std::int64_t>(std::floor(p.y * inv_voxel_));
+        const auto iz = static_cast<std::int64_t>(std::floor(p.z * inv_voxel_));
+        return ((static_cast<std::uint64_t>(ix) & k21) << 42) |
+               ((static_cast<std::uint64_t>(iy) & k21) << 21) |
+               (static_cast<std::uint64_t>(iz) & k21);
+    }
+
+    // Priorita labelu ve voxelu: co je pro operátora důležitější, vyhraje.
+    static int rank(std::uint8_t label)
+    {
+        switch (label) {
+        case GroundSegmentation::kNegative: return 4;
+        case GroundSegmentation::kObstacle: return 3;
+        case GroundSegmentation::kGround:   return 2;
+        case GroundSegmentation::kOther:    return 1;
+        default:                            return 0;
+        }
+    }
+
+    static std::int16_t quantize(float cm)
+    {
+        return static_cast<std::int16_t>(std::clamp(std::lround(cm), -32767l, 32767l));
+    }
+
+    unsigned                   voxel_cm_;
+    float                      inv_voxel_;
+    unsigned                   shift_ = 64;
+    std::vector<std::uint32_t> slots_;
+    std::vector<Voxel>         voxels_;
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+// corridor_finder.hpp — hledání volných koridorů kolem robota
+// ---------------------------------------------------------------------------
+// • Polární sken volného prostoru: pro každý úhlový bin (default 2°) spočte
+//   vzdálenost nejbližší překážky (label z GroundSegmentation, v cm, rámec robota).
+// • Koridor = souvislý (i přes ±180°) úsek binů s volnou hloubkou ≥ min_depth_cm
+//   a šířkou (tětiva v nejmenší hloubce úseku) ≥ min_width_cm.
+// • Azimut: 0° = vpřed (+x), kladně doleva (+y), rozsah (-180°, 180°].
+// • Počítá se jednou za otáčku LiDARu (LidarController::onRevolution),
+//   klienti jen čtou poslední publikovaný CorridorSet.
+//
+// Vektorizace: body se zpracují po blocích do SoA polí; výpočet d², binu
+// (rychlý atan2 bez knihovního volání) a masky překážek je smyčka bez větvení,
+// kterou kompilátor převede na SIMD. Scatter-min do binů zůstává skalární.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "point_processing.hpp"
+
+struct Corridor
+{
+    float from_deg;     // pravý okraj (menší azimut)
+    float to_deg;       // levý okraj (větší azimut, může přetéct přes 180°)
+    float center_deg;   // střed koridoru, normalizovaný do (-180, 180]
+    float width_cm;     // šířka (tětiva) v hloubce depth_cm
+    float depth_cm;     // nejmenší volná hloubka v koridoru
+};
+
+struct CorridorSet
+{
+    std::uint64_t         rev = 0;     // pořadí otáčky, ze které byl výsledek spočten
+    double                stamp = 0.0; // čas výpočtu [s]
+    std::vector<Corridor> corridors;
+
+    // Textová odpověď pro TCP: "<rev> <n> [<from> <to> <center> <width> <depth>]..."
+    std::string toLine() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(1);
+        os << rev << " " << corridors.size();
+        for (const auto &c : corridors) {
+            os << " " << c.from_deg << " " << c.to_deg << " " << c.center_deg
+               << " " << c.width_cm << " " << c.depth_cm;
+        }
+        return os.str();
+    }
+};
+
+class CorridorFinder
+{
+public:
+    struct Params {
+        float max_range_cm = 1000.0f;  // dál nás to nezajímá (prázdný bin = volno do max_range)
+        float min_depth_cm = 150.0f;   // koridor musí být volný aspoň do této hloubky
+        float min_width_cm =  60.0f;   // šířka robota + rezerva
+    };
+
+    static constexpr int kBins = 180;  // 2° na bin
+
+    CorridorFinder() = default;
+    explicit CorridorFinder(const Params &p) : params_(p) {}
+
+    const Params &params() const { return params_; }
+
+    // Polární sken + extrakce koridorů nad celým bufferem bodů.
+    // comp převádí body do aktuálního rámce robota (kompenzace pohybu).
+    CorridorSet compute(const LidarPointProcessing::Sample *samples,
+                        std::size_t n,
+                        EgoCompensator &comp,
+                        std::uint64_t rev,
+                        double stamp)
+    {
+        scanFreeSpace(samples, n, comp);
+
+        CorridorSet out;
+        out.rev   = rev;
+        out.stamp = stamp;
+        extractCorridors(out.corridors);
+        return out;
+    }
+
+    // Poslední polární sken (volná hloubka v cm pro každý bin).
+    const std::array<float, kBins> &depth() const { return depth_; }
+
+private:
+    static constexpr std::size_t kBlock = 256;
+    static constexpr float kBinDeg = 360.0f / kBins;
+
+    // atan2 aproximace (max. chyba ~0.2°), bez větvení → vektorizovatelná.
+    static inline float fastAtan2Deg(float y, float x)
+    {
+        const float ax = std::fabs(x);
+        const float ay = std::fabs(y);
+        const float mx = std::max(ax, ay);
+        const float mn = std::min(ax, ay);
+        const float a  = mn / (mx + 1e-12f);
+        const float s  = a * a;
+        float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+        r = (ay > ax) ? 1.57079637f - r : r;
+        r = (x < 0.0f) ? 3.14159274f - r : r;
+        r = (y < 0.0f) ? -r : r;
+        return r * 57.2957795f;
+    }
+
+    void scanFreeSpace(const LidarPointProcessing::Sample *samples, std::size_t n,
+                       EgoCompensator &comp)
+    {
+        const float max_sq = params_.max_range_cm * params_.max_range_cm;
+        std::array<float, kBins> min_sq;
+        min_sq.fill(max_sq);
+
+        alignas(32) float bx[kBlock], by[kBlock];
+        alignas(32) std::uint8_t bl[kBlock];
+        alignas(32) float d2[kBlock];
+        alignas(32) std::int32_t bin[kBlock];
+
+        for (std::size_t base = 0; base < n; base += kBlock) {
+            const std::size_t m = std::min(kBlock, n - base);
+
+            // AoS → SoA (+ převod do aktuálního rámce robota)
+            for (std::size_t i = 0; i < m; ++i) {
+                const auto &s = samples[base + i];
+                // vypršelá pose batche → bod se maskuje jako "ostatní"
+                bl[i] = comp.apply(s.batch, s.x, s.y, bx[i], by[i])
+                            ? s.label : static_cast<std::uint8_t>(GroundSegmentation::kOther);
+            }
+
+            // vektorizovatelná část: d², bin, maskování překážek
+            for (std::size_t i = 0; i < m; ++i) {
+                const float x = bx[i], y = by[i];
+                const bool obstacle = bl[i] == GroundSegmentation::kObstacle ||
+                                      bl[i] == GroundSegmentation::kNegative;
+                const float dd = x * x + y * y;
+                d2[i] = obstacle ? dd : max_sq;
+                float b = (fastAtan2Deg(y, x) + 180.0f) * (1.0f / kBinDeg);
+                std::int32_t bi = static_cast<std::int32_t>(b);
+                bin[i] = bi >= kBins ? kBins - 1 : (bi < 0 ? 0 : bi);
+            }
+
+            // scatter-min
+            for (std::size_t i = 0; i < m; ++i) {
+                float &cur = min_sq[static_cast<std::size_t>(bin[i])];
+                cur = std::min(cur, d2[i]);
+            }
+        }
+
+        for (int b = 0; b < kBins; ++b) {
+            depth_[b] = std::sqrt(min_sq[b]);
+        }
+    }
+
+    static float binStartDeg(int b) { return -180.0f + b * kBinDeg; }
+
+    static float normDeg(float a)
+    {
+        while (a > 180.0f)   a -= 360.0f;
+        while (a <= -180.0f) a += 360.0f;
+        return a;
+    }
+
+    void emitRun(int start, int len, std::vector<Corridor> &out) const
+    {
+        float dmin = params_.max_range_cm;
+        for (int k = 0; k < len; ++k) {
+            dmin = std::min(dmin, depth_[(start + k) % kBins]);
+        }
+
+        const float span_deg = len * kBinDeg;
+        const float half_rad = 0.5f * span_deg * static_cast<float>(M_PI) / 180.0f;
+        const float width = (span_deg >= 180.0f) ? 2.0f * dmin
+                                                 : 2.0f * dmin * std::sin(half_rad);
+        if (width < params_.min_width_cm) {
+            return;
+        }
+
+        Corridor c;
+        c.from_deg   = binStartDeg(start);
+        c.to_deg     = c.from_deg + span_deg;
+        c.center_deg = normDeg(c.from_deg + 0.5f * span_deg);
+        c.width_cm   = width;
+        c.depth_cm   = dmin;
+        out.push_back(c);
+    }
+
+    void extractCorridors(std::vector<Corridor> &out) const
+    {
+        out.clear();
+
+        // začni za prvním blokovaným binem, aby se koridor přes ±180° nerozdělil
+        int first_blocked = -1;
+        for (int b = 0; b < kBins; ++b) {
+            if (depth_[b] < params_.min_depth_cm) { first_blocked = b; break; }
+        }
+        if (first_blocked < 0) {
+            // volno všude kolem
+            Corridor c{-180.0f, 180.0f, 0.0f, 2.0f * params_.max_range_cm, params_.max_range_cm};
+            for (float d : depth_) c.depth_cm = std::min(c.depth_cm, d);
+            c.width_cm = 2.0f * c.depth_cm;
+            out.push_back(c);
+            return;
+        }
+
+        int run_start = -1;
+        for (int k = 1; k <= kBins; ++k) {
+            const int b = (first_blocked + k) % kBins;
+            const bool free = depth_[b] >= params_.min_depth_cm;
+            if (free && run_start < 0) {
+                run_start = b;
+            } else if (!free && run_start >= 0) {
+                const int len = (b - run_start + kBins) % kBins;
+                emitRun(run_start, len, out);
+                run_start = -1;
+            }
+        }
+    }
+
+    Params params_;
+    std::array<float, kBins> depth_{};
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+// distance_histogram.hpp — průběžné histogramy vzdáleností překážek po sektorech
+// ---------------------------------------------------------------------------
+// • kSectors azimutových sektorů (rámec robota, sektor 0 začíná na -180°)
+//   × kBins binů po kBinCm; poslední bin = "dál". Počítají se jen body
+//   s labelem překážka.
+// • Inkrementálně: add() při zápisu bodu do ring bufferu, remove() při jeho
+//   přepsání (eviction) → histogram vždy odpovídá obsahu bufferu.
+// • Navíc souhrnný histogram přes všechny sektory (dotaz bez azimutu).
+// • Dotazy bez řazení bufferu: k-tý nejbližší bod / percentil = průchod
+//   kumulativních četností přes pevný počet binů (kBins), nezávisle na
+//   počtu bodů. Rozlišení = kBinCm, vrací se střed binu.
+// • Vzdálenost i sektor jsou v rámci robota v čase záznamu bodu (bez
+//   kompenzace pohybu – ta se dělá až při dotazu nad bufferem, tady by
+//   znamenala přepočet všech bodů).
+// • Zapisuje jedno vlákno (loopRead), číst lze odkudkoli (relaxed atomiky).
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+class DistanceHistogram
+{
+public:
+    static constexpr int   kSectors = 36;          // 10°
+    static constexpr int   kBins    = 200;
+    static constexpr float kBinCm   = 5.0f;        // 200 × 5 cm = 10 m
+
+    DistanceHistogram() { clear(); }
+
+    void clear()
+    {
+        for (auto &s : counts_) for (auto &c : s) c.store(0, std::memory_order_relaxed);
+        for (auto &t : totals_) t.store(0, std::memory_order_relaxed);
+        for (auto &c : all_) c.store(0, std::memory_order_relaxed);
+        all_total_.store(0, std::memory_order_relaxed);
+    }
+
+    void add(float x, float y)    { bump(x, y, +1); }
+    void remove(float x, float y) { bump(x, y, -1); }
+
+    static int sectorOf(float x, float y)
+    {
+        const float a = std::atan2(y, x);   // (-π, π]
+        const int s = static_cast<int>((a + static_cast<float>(M_PI)) *
+                                       (kSectors / (2.0f * static_cast<float>(M_PI))));
+        return s >= kSectors ? kSectors - 1 : (s < 0 ? 0 : s);
+    }
+
+    // Střed sektoru [deg] v rámci robota.
+    static float sectorCenterDeg(int s)
+    {
+        return -180.0f + (s + 0.5f) * (360.0f / kSectors);
+    }
+
+    std::uint32_t total(int sector) const
+    {
+        return totals_[sector].load(std::memory_order_relaxed);
+    }
+
+    // k-tý nejbližší bod (k >= 1) přes sektory [s_from, s_to] (včetně, s wrap).
+    // Vrací vzdálenost [cm] nebo -1, pokud v sektorech není k bodů.
+    float kth(std::uint32_t k, int s_from, int s_to) const
+    {
+        if (k == 0) k = 1;
+        std::uint32_t cum = 0;
+        for (int b = 0; b < kBins; ++b) {
+            for (int s = s_from;; s = (s + 1) % kSectors) {
+                cum += counts_[s][b].load(std::memory_order_relaxed);
+                if (s == s_to) break;
+            }
+            if (cum >= k) return (b + 0.5f) * kBinCm;
+        }
+        return -1.0f;
+    }
+
+    float kth(std::uint32_t k) const
+    {
+        if (k == 0) k = 1;
+        std::uint32_t cum = 0;
+        for (int b = 0; b < kBins; ++b) {
+            cum += all_[b].load(std::memory_order_relaxed);
+            if (cum >= k) return (b + 0.5f) * kBinCm;
+        }
+        return -1.0f;
+    }
+
+    // Percentil p ∈ (0, 100] vzdáleností v sektorech [s_from, s_to].
+    float percentile(float p, int s_from, int s_to) const
+    {
+        std::uint32_t n = 0;
+        for (int s = s_from;; s = (s + 1) % kSectors) {
+            n += total(s);
+            if (s == s_to) break;
+        }
+        if (n == 0) return -1.0f;
+        const float q = p <= 0.0f ? 0.0f : (p > 100.0f ? 100.0f : p);
+        std::uint32_t k = static_cast<std::uint32_t>(std::ceil(q / 100.0f * n));
+        return kth(k ? k : 1, s_from, s_to);
+    }
+
+    float percentile(float p) const
+    {
+        const std::uint32_t n = all_total_.load(std::memory_order_relaxed);
+        if (n == 0) return -1.0f;
+        const float q = p <= 0.0f ? 0.0f : (p > 100.0f ? 100.0f : p);
+        const std::uint32_t k = static_cast<std::uint32_t>(std::ceil(q / 100.0f * n));
+        return kth(k ? k : 1);
+    }
+
+private:
+    void bump(float x, float y, int d)
+    {
+        const int s = sectorOf(x, y);
+        int b = static_cast<int>(std::sqrt(x * x + y * y) / kBinCm);
+        if (b >= kBins) b = kBins - 1;
+        auto &c = counts_[s][b];
+        c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+        auto &t = totals_[s];
+        t.store(t.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+        auto &a = all_[b];
+        a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+        all_total_.store(all_total_.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+
+    std::array<std::array<std::atomic<std::uint32_t>, kBins>, kSectors> counts_;
+    std::array<std::atomic<std::uint32_t>, kSectors>                    totals_;
+    std::array<std::atomic<std::uint32_t>, kBins>                       all_;
+    std::atomic<std::uint32_t>                                          all_total_;
+};
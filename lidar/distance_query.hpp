@@ -0,0 +1,208 @@
+#pragma once
+
+// distance_query.hpp — parametrizovaný dotaz DISTANCE + cache výsledků
+// ---------------------------------------------------------------------------
+// • DistanceQuery: z-pásmo, azimutový výřez, max. stáří bodů, vzdálenost
+//   k obrysu robota místo ke středu. Text (TCP):
+//       DISTANCE zmin=-30 zmax=60 az=-30:30 age=300 footprint
+//   zmin/zmax [cm, rámec robota] – bez nich rozhoduje segmentace země,
+//   az=<od>:<do> [deg, x vpřed = 0, y vlevo = +90, může přes ±180],
+//   age [ms], footprint = vzdálenost k obdélníku robota,
+//   neg = negativní překážky (hrany, díry) místo překážek nad zemí.
+//   P<p> / K=<k> (036) = robustní varianta z histogramů; jde jen s az=
+//   (histogram nezná z, stáří, footprint ani neg) – jiná kombinace je chyba.
+// • DistanceQueryCache: výsledky podle (dotaz, slot dat). Slot = epocha /
+//   kEpochPackets, epocha = počet zpracovaných paketů → výsledek platí
+//   ~75 ms (16 paketů) a dokud nepřijde nový paket, stejný dotaz od jiného
+//   klienta stojí jen hash lookup. Novější slot cache vyprázdní, dotaz se
+//   starší epochou (opožděný klient) se spočítá mimo cache.
+//   Výpočet běží mimo zámek: první klient vloží značku "počítá se",
+//   souběžné stejné dotazy čekají na výsledek, jiné dotazy počítají
+//   paralelně.
+// ---------------------------------------------------------------------------
+
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+struct DistanceQuery
+{
+    bool  use_z = false;          // false = label překážka ze segmentace země
+    float z_min = 0.0f;           // [cm]
+    float z_max = 0.0f;
+    bool  use_az = false;
+    float az_from = 0.0f;         // [deg]
+    float az_to = 0.0f;
+    float max_age = 0.0f;         // [s], 0 = celý buffer
+    bool  footprint = false;
+    bool  negative = false;       // label kNegative (z-pásmo se ignoruje)
+
+    // Robustní varianty z DistanceHistogram (0 = nepoužito).
+    float         percentile = 0.0f;
+    std::uint32_t kth = 0;
+
+    bool robust() const { return percentile > 0.0f || kth > 0; }
+
+    // Parsování parametrů za "DISTANCE ". false = neznámý / vadný token.
+    bool parse(const std::string &args)
+    {
+        std::istringstream is(args);
+        std::string tok;
+        bool has_zmin = false, has_zmax = false;
+        while (is >> tok) {
+            float a = 0.0f, b = 0.0f;
+            unsigned k = 0;
+            if (std::sscanf(tok.c_str(), "zmin=%f", &a) == 1) {
+                z_min = a; has_zmin = true;
+            } else if (std::sscanf(tok.c_str(), "zmax=%f", &a) == 1) {
+                z_max = a; has_zmax = true;
+            } else if (std::sscanf(tok.c_str(), "az=%f:%f", &a, &b) == 2) {
+                use_az = true; az_from = a; az_to = b;
+            } else if (std::sscanf(tok.c_str(), "age=%f", &a) == 1) {
+                if (a < 0.0f) return false;
+                max_age = a / 1000.0f;
+            } else if (tok == "footprint") {
+                footprint = true;
+            } else if (tok == "neg") {
+                negative = true;
+            } else if (std::sscanf(tok.c_str(), "K=%u", &k) == 1) {
+                if (k == 0) return false;
+                kth = k;
+            } else if (tok[0] == 'P' && std::sscanf(tok.c_str() + 1, "%f", &a) == 1) {
+                if (a <= 0.0f || a > 100.0f) return false;
+                percentile = a;
+            } else {
+                return false;
+            }
+        }
+        if (has_zmin || has_zmax) {
+            use_z = true;
+            if (!has_zmin) z_min = -1e9f;
+            if (!has_zmax) z_max =  1e9f;
+        }
+        // histogram má jen azimut – ostatní filtry by se tiše ignorovaly
+        if (robust() && (use_z || max_age > 0.0f || footprint || negative ||
+                         (percentile > 0.0f && kth > 0))) {
+            return false;
+        }
+        return true;
+    }
+
+    // Bod [cm, aktuální rámec robota] v azimutovém výřezu?
+    bool inAzimuth(float x, float y) const
+    {
+        if (!use_az) return true;
+        const float a = std::atan2(y, x) * (180.0f / static_cast<float>(M_PI));
+        return az_from <= az_to ? (a >= az_from && a <= az_to)
+                                : (a >= az_from || a <= az_to);   // přes ±180°
+    }
+
+    bool operator==(const DistanceQuery &o) const
+    {
+        return use_z == o.use_z && z_min == o.z_min && z_max == o.z_max &&
+               use_az == o.use_az && az_from == o.az_from && az_to == o.az_to &&
+               max_age == o.max_age && footprint == o.footprint && negative == o.negative &&
+               percentile == o.percentile && kth == o.kth;
+    }
+
+    struct Hash {
+        std::size_t operator()(const DistanceQuery &q) const
+        {
+            auto mix = [](std::size_t h, std::size_t v) {
+                return h ^ (v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+            };
+            std::size_t h = 0;
+            const float f[] = {q.z_min, q.z_max, q.az_from, q.az_to, q.max_age, q.percentile};
+            for (float v : f) h = mix(h, std::hash<float>{}(v));
+            h = mix(h, q.kth);
+            h = mix(h, (q.use_z ? 1u : 0u) | (q.use_az ? 2u : 0u) | (q.footprint ? 4u : 0u) |
+                       (q.negative ? 8u : 0u));
+            return h;
+        }
+    };
+};
+
+class DistanceQueryCache
+{
+public:
+    static constexpr std::size_t   kMaxEntries = 64;
+    static constexpr std::uint64_t kEpochPackets = 16;    // ~75 ms při 216 paketech/s
+
+    // Výsledek z cache, jinak compute() a uložení. compute běží mimo zámek;
+    // souběžné stejné dotazy počkají na značku in-flight a vezmou hotový
+    // výsledek. Plná cache = počítá se bez ukládání.
+    template <typename Compute>
+    float get(const DistanceQuery &q, std::uint64_t epoch, Compute compute)
+    {
+        const std::uint64_t slot = epoch / kEpochPackets;
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (slot < slot_) {
+            // klient se starší epochou: spočítat bez cache, novější slot nechat
+            ++misses_;
+            lk.unlock();
+            return compute(q);
+        }
+        if (slot > slot_) {
+            map_.clear();
+            slot_ = slot;
+            cv_.notify_all();   // čekající na starý slot počítají sami
+        }
+        auto it = map_.find(q);
+        if (it != map_.end() && !it->second.ready) {
+            cv_.wait(lk, [&] {
+                it = map_.find(q);
+                return slot_ != slot || it == map_.end() || it->second.ready;
+            });
+        }
+        if (slot_ == slot && it != map_.end() && it->second.ready) {
+            ++hits_;
+            return it->second.value;
+        }
+
+        ++misses_;
+        const bool cache = slot_ == slot && map_.size() < kMaxEntries;
+        if (cache) map_[q] = Entry{0.0f, false};
+        lk.unlock();
+
+        const float v = compute(q);
+
+        if (cache) {
+            lk.lock();
+            it = map_.find(q);
+            if (slot_ == slot && it != map_.end()) {
+                it->second = Entry{v, true};
+            }
+            lk.unlock();
+            cv_.notify_all();
+        }
+        return v;
+    }
+
+    std::string toString(const char *name) const
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        std::ostringstream os;
+        os << name << " hits=" << hits_ << " misses=" << misses_;
+        return os.str();
+    }
+
+private:
+    struct Entry {
+        float value;
+        bool  ready;    // false = in-flight, počítá ho jiný klient
+    };
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::unordered_map<DistanceQuery, Entry, DistanceQuery::Hash> map_;
+    std::uint64_t slot_{0};     // jen roste
+    std::uint64_t hits_{0};
+    std::uint64_t misses_{0};
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+// distance_transform.hpp — euklidovská distanční transformace mřížky obsazenosti
+// ---------------------------------------------------------------------------
+// • Felzenszwalb & Huttenlocher: 1D transformace dolní obálky parabol, O(n)
+//   na řádek/sloupec; 2D = nejdřív sloupce, pak řádky.
+// • Vstup: snapshot EgoOccupancyGrid (buňka obsazená, pokud hits >= práh).
+// • Výstup: clearance [cm] pro každou buňku = vzdálenost ke středu nejbližší
+//   obsazené buňky; bez překážky v okně kMaxClearanceCm.
+// • Počítá se jednou za otáčku, sloupce i řádky jsou rozdělené mezi
+//   pevnou sadu pracovních vláken (ParallelFor).
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "parallel_for.hpp"
+
+class DistanceTransform
+{
+public:
+    static constexpr int   kSize = EgoOccupancyGrid::kSize;
+    static constexpr int   kCells = EgoOccupancyGrid::kCells;
+    static constexpr float kMaxClearanceCm = 1000.0f;
+
+    struct Result {
+        EgoOccupancyGrid::Meta meta{};   // geometrie shodná se snapshotem mřížky
+        std::vector<float> clearance_cm; // kCells, řádek po řádku
+    };
+
+    explicit DistanceTransform(ParallelFor &pool) : pool_(pool)
+    {
+        f_.resize(kCells);
+        per_thread_.resize(pool_.threads());
+        for (auto &w : per_thread_) {
+            w.v.resize(kSize);
+            w.z.resize(kSize + 1);
+            w.tmp.resize(kSize);
+        }
+    }
+
+    void compute(const EgoOccupancyGrid::Snapshot &grid, Result &out)
+    {
+        constexpr float kInf = 1e20f;
+        out.meta = grid.meta;
+        out.clearance_cm.resize(kCells);
+
+        for (int i = 0; i < kCells; ++i) {
+            f_[i] = grid.hits[i] >= EgoOccupancyGrid::kOccupiedHits ? 0.0f : kInf;
+        }
+
+        // 1) sloupce (stride kSize)
+        pool_.run(kSize, [&](int begin, int end, int worker) {
+            Work &w = per_thread_[worker];
+            for (int c = begin; c < end; ++c) {
+                for (int r = 0; r < kSize; ++r) w.tmp[r] = f_[r * kSize + c];
+                transform1d(w);
+                for (int r = 0; r < kSize; ++r) f_[r * kSize + c] = w.tmp[r];
+            }
+        });
+
+        // 2) řádky + převod na cm
+        const float cell = EgoOccupancyGrid::kCellCm;
+        pool_.run(kSize, [&](int begin, int end, int worker) {
+            Work &w = per_thread_[worker];
+            for (int r = begin; r < end; ++r) {
+                float *row = &f_[r * kSize];
+                std::copy(row, row + kSize, w.tmp.begin());
+                transform1d(w);
+                float *dst = &out.clearance_cm[r * kSize];
+                for (int c = 0; c < kSize; ++c) {
+                    dst[c] = std::min(std::sqrt(w.tmp[c]) * cell, kMaxClearanceCm);
+                }
+            }
+        });
+    }
+
+    // Clearance v bodě (rámec robota, cm); záporné = mimo okno.
+    static float lookup(const Result &res, float x_cm, float y_cm)
+    {
+        const auto &m = res.meta;
+        const float c = std::cos(m.pose_yaw), s = std::sin(m.pose_yaw);
+        const float wx = m.pose_x_cm + c * x_cm - s * y_cm;
+        const float wy = m.pose_y_cm + s * x_cm + c * y_cm;
+        const int cx = static_cast<int>(std::floor(wx / m.cell_cm)) - m.origin_cx;
+        const int cy = static_cast<int>(std::floor(wy / m.cell_cm)) - m.origin_cy;
+        if (cx < 0 || cy < 0 || cx >= kSize || cy >= kSize) {
+            return -1.0f;
+        }
+        return res.clearance_cm[cy * kSize + cx];
+    }
+
+private:
+    struct Work {
+        std::vector<int>   v;    // indexy parabol dolní obálky
+        std::vector<float> z;    // hranice mezi parabolami
+        std::vector<float> tmp;  // vstup/výstup 1D transformace
+    };
+
+    // 1D squared EDT nad w.tmp (in-place), Felzenszwalb 2012, alg. 1.
+    static void transform1d(Work &w)
+    {
+        constexpr float kInf = std::numeric_limits<float>::infinity();
+        const float *f = w.tmp.data();
+        int   *v = w.v.data();
+        float *z = w.z.data();
+
+        int k = -1;
+        for (int q = 0; q < kSize; ++q) {
+            if (f[q] >= 1e20f) continue;   // nekonečno parabolu netvoří
+            float s = 0.0f;
+            while (k >= 0) {
+                const int p = v[k];
+                s = ((f[q] + float(q) * q) - (f[p] + float(p) * p)) / (2.0f * (q - p));
+                if (s > z[k]) break;
+                --k;
+            }
+            ++k;
+            v[k] = q;
+            z[k] = (k == 0) ? -kInf : s;
+            z[k + 1] = kInf;
+        }
+
+        float out[kSize];
+        if (k < 0) {
+            std::fill(out, out + kSize, 1e20f);
+        } else {
+            int j = 0;
+            for (int q = 0; q < kSize; ++q) {
+                while (z[j + 1] < q) ++j;
+                const float d = float(q - v[j]);
+                out[q] = d * d + f[v[j]];
+            }
+        }
+        std::copy(out, out + kSize, w.tmp.begin());
+    }
+
+    ParallelFor       &pool_;
+    std::vector<float> f_;
+    std::vector<Work>  per_thread_;
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+// ego_motion.hpp — pose robota a kompenzace vlastního pohybu pro buffer bodů
+// ---------------------------------------------------------------------------
+// • OdomInput: poslední vzorky odometrie (kola / fusion) v libovolném
+//   odometrickém rámci [cm, rad]; plní je klienti příkazem ODOM (jiné vlákno,
+//   proto krátký mutex).
+// • PoseTracker: pose v čase t = translace z odometrie (interpolace,
+//   za posledním vzorkem extrapolace rychlostí, max. kMaxExtrapolation)
+//   + yaw z odometrie zpřesněný integrovaným gyrem (ImuHistory::yaw) mezi
+//   vzorky. Bez odometrie: translace 0, yaw jen z gyra.
+// • BatchPoses: každý paket (batch bodů v ring bufferu) dostane pořadové
+//   číslo a pose v referenčním čase deskew. Tabulka má kBatches slotů
+//   (seq % kBatches) a slot si pamatuje své seq – bod z paketu staršího než
+//   kBatches paketů (řídká scéna, málo platných bodů na paket) dostane
+//   místo cizí pose "vypršelo" a dotazy ho přeskočí.
+//   Body zůstávají v rámci robota v čase záznamu.
+// • EgoCompensator: při dotazu převádí body do aktuálního rámce robota.
+//   Transformace batch → teď se počítá líně, jednou pro každý batch,
+//   buffer se nikdy nepřepisuje.
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+
+#include "imu_deskew.hpp"
+
+struct Pose2D
+{
+    float x = 0.0f;     // [cm]
+    float y = 0.0f;     // [cm]
+    float yaw = 0.0f;   // [rad]
+};
+
+class OdomInput
+{
+public:
+    static constexpr int kCapacity = 32;
+
+    struct Sample {
+        double stamp;
+        Pose2D pose;
+    };
+
+    void push(double stamp, const Pose2D &p)
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        ring_[head_ % kCapacity] = Sample{stamp, p};
+        ++head_;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        head_ = 0;
+    }
+
+    // Dva nejbližší vzorky kolem t (nebo poslední dva); false = žádná odometrie.
+    bool bracket(double t, Sample &a, Sample &b) const
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        if (head_ == 0) return false;
+
+        const int n = head_ < kCapacity ? head_ : kCapacity;
+        b = ring_[(head_ - 1) % kCapacity];
+        a = n > 1 ? ring_[(head_ - 2) % kCapacity] : b;
+        if (t >= b.stamp) return true;
+
+        for (int k = 1; k < n; ++k) {
+            const Sample &lo = ring_[(head_ - 1 - k) % kCapacity];
+            const Sample &hi = ring_[(head_ - k) % kCapacity];
+            if (t >= lo.stamp) { a = lo; b = hi; return true; }
+        }
+        a = b = ring_[(head_ - n) % kCapacity];
+        return true;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::array<Sample, kCapacity> ring_{};
+    int head_{0};
+};
+
+class PoseTracker
+{
+public:
+    static constexpr double kMaxExtrapolation = 0.5;   // [s]
+
+    PoseTracker(const ImuHistory &imu, const OdomInput &odom) : imu_(imu), odom_(odom) {}
+
+    Pose2D poseAt(double t) const
+    {
+        Pose2D p;
+        OdomInput::Sample a, b;
+        double gyro_t;
+        if (odom_.bracket(t, a, b)) {
+            double u = 0.0;
+            const double span = b.stamp - a.stamp;
+            if (span > 1e-6) {
+                u = (t - a.stamp) / span;
+                const double u_max = 1.0 + kMaxExtrapolation / span;
+                u = u < 0.0 ? 0.0 : (u > u_max ? u_max : u);
+            }
+            p.x = a.pose.x + static_cast<float>(u) * (b.pose.x - a.pose.x);
+            p.y = a.pose.y + static_cast<float>(u) * (b.pose.y - a.pose.y);
+
+            // yaw: vzorek odometrie nejblíž t + gyro od té doby
+            const OdomInput::Sample &ref = (t >= b.stamp || u > 0.5) ? b : a;
+            p.yaw = ref.pose.yaw;
+            gyro_t = ref.stamp;
+        } else {
+            gyro_t = 0.0;
+        }
+
+        double y_t, y_ref;
+        if (imu_.yawAt(t, y_t) && (gyro_t == 0.0 || imu_.yawAt(gyro_t, y_ref))) {
+            p.yaw += static_cast<float>(gyro_t == 0.0 ? y_t : y_t - y_ref);
+        }
+        return p;
+    }
+
+private:
+    const ImuHistory &imu_;
+    const OdomInput  &odom_;
+};
+
+class BatchPoses
+{
+public:
+    static constexpr std::uint32_t kBatches = 4096;   // ~19 s paketů (216 Hz)
+
+    static std::uint32_t slot(std::uint32_t seq) { return seq % kBatches; }
+
+    void clear()
+    {
+        next_ = 1;
+        for (Entry &e : poses_) e.seq = 0;   // 0 = nikdy nepřiděleno
+    }
+
+    std::uint32_t begin(const Pose2D &p)
+    {
+        const std::uint32_t seq = next_++;
+        if (next_ == 0) next_ = 1;
+        poses_[slot(seq)] = Entry{seq, p};
+        current_ = p;
+        return seq;
+    }
+
+    // false = slot už patří novějšímu paketu (pose vypršela).
+    bool pose(std::uint32_t seq, Pose2D &out) const
+    {
+        const Entry &e = poses_[slot(seq)];
+        if (seq == 0 || e.seq != seq) return false;
+        out = e.pose;
+        return true;
+    }
+
+    const Pose2D &current() const { return current_; }
+
+private:
+    struct Entry {
+        std::uint32_t seq;
+        Pose2D        pose;
+    };
+
+    std::array<Entry, kBatches> poses_{};
+    Pose2D        current_{};
+    std::uint32_t next_{1};
+};
+
+// Líná cache transformací batch → aktuální rámec robota (platí pro jeden dotaz).
+class EgoCompensator
+{
+public:
+    EgoCompensator(const BatchPoses &batches, const Pose2D &now)
+        : batches_(batches), now_(now),
+          c_now_(std::cos(now.yaw)), s_now_(std::sin(now.yaw)) {}
+
+    // false = pose batche vypršela, bod se má přeskočit (ox, oy neplatné).
+    inline bool apply(std::uint32_t batch, float x, float y, float &ox, float &oy)
+    {
+        const std::uint32_t i = BatchPoses::slot(batch);
+        if (!done_[i] || seq_[i] != batch) build(i, batch);
+        const Affine &a = aff_[i];
+        ox = a.c * x - a.s * y + a.tx;
+        oy = a.s * x + a.c * y + a.ty;
+        return a.valid;
+    }
+
+private:
+    struct Affine { float c, s, tx, ty; bool valid; };
+
+    void build(std::uint32_t i, std::uint32_t batch)
+    {
+        Affine &a = aff_[i];
+        seq_[i] = batch;
+        done_[i] = true;
+        Pose2D b;
+        if (!batches_.pose(batch, b)) {
+            a = Affine{1.0f, 0.0f, 0.0f, 0.0f, false};
+            return;
+        }
+        // inv(P_now) * P_batch
+        const float dyaw = b.yaw - now_.yaw;
+        const float dx = b.x - now_.x;
+        const float dy = b.y - now_.y;
+        a.c  = std::cos(dyaw);
+        a.s  = std::sin(dyaw);
+        a.tx =  c_now_ * dx + s_now_ * dy;
+        a.ty = -s_now_ * dx + c_now_ * dy;
+        a.valid = true;
+    }
+
+    const BatchPoses &batches_;
+    Pose2D now_;
+    float  c_now_, s_now_;
+    std::array<Affine, BatchPoses::kBatches> aff_;
+    std::array<std::uint32_t, BatchPoses::kBatches> seq_;
+    std::bitset<BatchPoses::kBatches> done_;
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+// ground_segmentation.hpp — rychlá segmentace země po sektorech (line-fit)
+// ---------------------------------------------------------------------------
+// • Polární mřížka kolem robota: kSectors azimutových sektorů × kBins
+//   radiálních binů (kBinCm). Pro každý bin se drží nejnižší bod (min z)
+//   s časem; starší než kBinTtl se přepíše.
+// • Pro každý sektor se fituje přímka z = a + b·r (nejmenší čtverce přes
+//   nejnižší body binů, jedna iterace odstranění bodů vysoko nad přímkou,
+//   omezení sklonu kMaxSlope). Fit se přepočítá jen pro sektory, do kterých
+//   padl nějaký bod aktuálního paketu → cena je úměrná paketu, ne oknu.
+// • Tagování bodu: h = z - (a + b·r) = výška nad lokální zemí.
+//     |h| <= kGroundTol               → země
+//     h ∈ (kGroundTol, kMaxObstacleH]  → překážka
+//   Sektor bez fitu (málo dat) → záložní pevné z-pásmo [z_min, z_max].
+// • Vše v cm, rámec robota.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+class GroundSegmentation
+{
+public:
+    static constexpr int   kSectors      = 64;
+    static constexpr int   kBins         = 32;
+    static constexpr float kBinCm        = 25.0f;          // 32 × 25 cm = 8 m
+    static constexpr float kGroundTol    = 10.0f;          // |h| do 10 cm = země
+    static constexpr float kMaxObstacleH = 150.0f;         // výš nás nezajímá (větve)
+    static constexpr float kMaxSlope     = 0.27f;          // ~15°
+    static constexpr double kBinTtl      = 1.0;            // [s]
+    static constexpr int   kMinFitBins   = 3;
+
+    enum Label : std::uint8_t {
+        kUnknown  = 0,
+        kGround   = 1,
+        kObstacle = 2,
+        kOther    = 3,     // pod zemí / nad kMaxObstacleH
+        kNegative = 4,     // negativní překážka (NegativeObstacleDetector)
+    };
+
+    struct SectorModel {
+        float a = 0.0f;     // z na r = 0
+        float b = 0.0f;     // sklon dz/dr
+        bool  valid = false;
+    };
+
+    GroundSegmentation() { clear(); }
+
+    void clear()
+    {
+        for (auto &s : bins_) {
+            for (auto &b : s) { b.min_z = 0.0f; b.stamp = -1.0; }
+        }
+        for (auto &m : model_) m = SectorModel{};
+    }
+
+    // Segmentace jedné skenovací linie (body už v rámci robota, cm).
+    // PointT: x, y, z, valid(), label, height (RangeImage::Cell) – výsledek
+    // se zapisuje rovnou do bodů. z_min/z_max = záložní pásmo.
+    template <typename PointT>
+    void segment(PointT *pts, std::size_t n, double stamp, float z_min, float z_max)
+    {
+        sector_idx_.resize(n);
+        radius_.resize(n);
+
+        std::array<bool, kSectors> touched{};
+
+        // 1) binning: nejnižší bod každého binu
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto &p = pts[i];
+            if (!p.valid()) continue;
+            const float r = std::sqrt(p.x * p.x + p.y * p.y);
+            const int s = sectorOf(p.x, p.y);
+            sector_idx_[i] = static_cast<std::uint8_t>(s);
+            radius_[i] = r;
+
+            const int b = static_cast<int>(r / kBinCm);
+            if (b >= kBins) continue;
+
+            Bin &bin = bins_[s][b];
+            if (bin.stamp < stamp - kBinTtl || p.z < bin.min_z) {
+                bin.min_z = p.z;
+                bin.stamp = stamp;
+            }
+            touched[s] = true;
+        }
+
+        // 2) refit dotčených sektorů
+        for (int s = 0; s < kSectors; ++s) {
+            if (touched[s]) fitSector(s, stamp);
+        }
+
+        // 3) tagování
+        for (std::size_t i = 0; i < n; ++i) {
+            auto &p = pts[i];
+            if (!p.valid()) continue;
+            const SectorModel &m = model_[sector_idx_[i]];
+            float h;
+            if (m.valid) {
+                h = p.z - (m.a + m.b * radius_[i]);
+            } else {
+                // záložní pevné pásmo: "výška" relativně k z_min
+                h = (p.z >= z_min && p.z <= z_max) ? kGroundTol + 1.0f : -1000.0f;
+            }
+            p.height = h;
+
+            std::uint8_t l;
+            if (std::fabs(h) <= kGroundTol)      l = kGround;
+            else if (h > kGroundTol && h <= kMaxObstacleH) l = kObstacle;
+            else                                  l = kOther;
+            p.label = l;
+        }
+    }
+
+    const SectorModel &model(int sector) const { return model_[sector]; }
+
+    static int sectorOf(float x, float y)
+    {
+        const float a = std::atan2(y, x);   // (-π, π]
+        int s = static_cast<int>((a + static_cast<float>(M_PI)) *
+                                 (kSectors / (2.0f * static_cast<float>(M_PI))));
+        return s >= kSectors ? kSectors - 1 : (s < 0 ? 0 : s);
+    }
+
+private:
+    struct Bin {
+        float  min_z;
+        double stamp;
+    };
+
+    void fitSector(int s, double stamp)
+    {
+        float rs[kBins], zs[kBins];
+        int n = 0;
+        for (int b = 0; b < kBins; ++b) {
+            const Bin &bin = bins_[s][b];
+            if (bin.stamp < stamp - kBinTtl) continue;
+            rs[n] = (b + 0.5f) * kBinCm;
+            zs[n] = bin.min_z;
+            ++n;
+        }
+
+        SectorModel m;
+        if (n < kMinFitBins || !lineFit(rs, zs, n, m)) {
+            model_[s].valid = false;
+            return;
+        }
+
+        // jedna iterace: vyhoď biny vysoko nad přímkou (překážka bez země za ní)
+        int k = 0;
+        for (int i = 0; i < n; ++i) {
+            if (zs[i] - (m.a + m.b * rs[i]) <= 2.0f * kGroundTol) {
+                rs[k] = rs[i]; zs[k] = zs[i]; ++k;
+            }
+        }
+        if (k >= kMinFitBins && k < n) {
+            lineFit(rs, zs, k, m);
+        }
+
+        if (std::fabs(m.b) > kMaxSlope) {
+            // nereálný sklon → vodorovná rovina v nejnižším bodě sektoru
+            m.b = 0.0f;
+            m.a = *std::min_element(zs, zs + (k > 0 ? k : n));
+        }
+        m.valid = true;
+        model_[s] = m;
+    }
+
+    static bool lineFit(const float *r, const float *z, int n, SectorModel &m)
+    {
+        float sr = 0, sz = 0, srr = 0, srz = 0;
+        for (int i = 0; i < n; ++i) {
+            sr += r[i]; sz += z[i]; srr += r[i] * r[i]; srz += r[i] * z[i];
+        }
+        const float den = n * srr - sr * sr;
+        if (std::fabs(den) < 1e-3f) return false;
+        m.b = (n * srz - sr * sz) / den;
+        m.a = (sz - m.b * sr) / n;
+        return true;
+    }
+
+    std::array<std::array<Bin, kBins>, kSectors> bins_{};
+    std::array<SectorModel, kSectors> model_{};
+
+    // pracovní pole (recyklovaná mezi pakety)
+    std::vector<std::uint8_t> sector_idx_;
+    std::vector<float>        radius_;
+};
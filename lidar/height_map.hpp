@@ -0,0 +1,346 @@
+#pragma once
+
+// height_map.hpp — 2.5D výšková mapa kolem robota + průjezdnost
+// ---------------------------------------------------------------------------
+// • kSize × kSize buněk po kCellCm (100 × 100 × 10 cm = 10 × 10 m), stejně
+//   jako EgoOccupancyGrid zarovnaná s odometrickým rámcem, toroidní úložiště,
+//   rolování jen nuluje nově vstupující řádky/sloupce.
+// • Buňka: z min / max / součet + počet bodů [cm, rámec robota]. Okno buňky
+//   začíná prvním zásahem; po kWindowTicks se buňka při dalším zásahu
+//   vynuluje → min/max se obnovují. expire() jednou za otáčku zahodí buňky
+//   bez zásahu déle než kWindowTicks (mimo zorné pole, zakryté) – věk tak
+//   nikdy nepřeroste periodu přetečení uint16 tiků.
+// • Zápis po paketech: insertLine() bere celou linii range image, sousední
+//   body linie ve stejné buňce se nejdřív sloučí (linie jde po zemi
+//   souvisle) → jeden zápis do buňky na úsek, ne na bod.
+// • Body: země, překážky i negativní překážky (ne kOther – větve nad
+//   robotem nejsou schod).
+// • Snapshot jednou za otáčku (rozbalený, int16 cm, kEmpty = bez dat):
+//   kompaktní export do shared memory / TCP HEIGHTMAP.
+// • Průjezdnost se počítá líně jen pro dotazovanou oblast (TCP TRAVERSE):
+//   skóre buňky 0..kBlocked je maximum ze tří poměrů:
+//     drsnost (max - min v buňce) / kMaxRoughCm,
+//     schod (rozdíl průměrů vůči 8 sousedům) / kMaxStepCm,
+//     sklon roviny proložené okolím ±kSlopeRadius buněk / kMaxSlope
+//   – sklon se měří na 50 cm, ne přes jednu buňku, jinak by každý
+//   přípustný schod vyšel jako nesjízdný svah. kUnknown = bez dat.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "ground_segmentation.hpp"
+
+class HeightMap
+{
+public:
+    static constexpr int   kSize  = 100;
+    static constexpr float kCellCm = 10.0f;
+    static constexpr int   kCells = kSize * kSize;
+    static constexpr std::uint16_t kWindowTicks = 100;   // 1 s (tiky EgoOccupancyGrid)
+    static constexpr std::int16_t  kEmpty = INT16_MIN;
+
+    // Skóre průjezdnosti
+    static constexpr std::uint8_t kBlocked = 250;        // >= nelze projet
+    static constexpr std::uint8_t kUnknown = 255;
+    static constexpr float kMaxStepCm  = 12.0f;          // schod, který ještě vyjedeme
+    static constexpr float kMaxRoughCm = 15.0f;
+    static constexpr float kMaxSlope   = 0.35f;          // ~19°
+    static constexpr int   kSlopeRadius = 2;             // fit roviny přes 5 × 5 buněk
+    static constexpr int   kMinFitCells = 6;
+
+    using Meta = EgoOccupancyGrid::Meta;
+
+    struct Snapshot {
+        Meta meta{};
+        std::vector<std::int16_t> z_min;    // kCells, řádek = y, sloupec = x
+        std::vector<std::int16_t> z_max;
+        std::vector<std::int16_t> z_mean;
+    };
+
+    // Souhrn průjezdnosti oblasti.
+    struct Region {
+        std::uint8_t worst = kUnknown;      // nejhorší známá buňka
+        float        mean = 0.0f;           // průměr známých buněk
+        int          known = 0;
+        int          total = 0;
+    };
+
+    HeightMap() { clear(); }
+
+    void clear()
+    {
+        for (auto &c : cells_) c = Cell{};
+        pose_x_ = pose_y_ = pose_yaw_ = 0.0f;
+        cos_yaw_ = 1.0f; sin_yaw_ = 0.0f;
+        center_cx_ = center_cy_ = 0;
+    }
+
+    void setPose(float x_cm, float y_cm, float yaw)
+    {
+        pose_x_ = x_cm; pose_y_ = y_cm; pose_yaw_ = yaw;
+        cos_yaw_ = std::cos(yaw);
+        sin_yaw_ = std::sin(yaw);
+        scrollTo(cellOf(x_cm), cellOf(y_cm));
+    }
+
+    // Jedna linie (PointT: x, y, z, valid(), label). Vrací počet zápisů do buněk.
+    template <typename PointT>
+    std::size_t insertLine(const PointT *pts, std::size_t n, std::uint16_t now)
+    {
+        std::size_t writes = 0;
+        int cur = -1;
+        Acc acc{};
+
+        for (std::size_t j = 0; j < n; ++j) {
+            const auto &p = pts[j];
+            if (!p.valid() || p.label == GroundSegmentation::kOther ||
+                p.label == GroundSegmentation::kUnknown) {
+                continue;
+            }
+            const float wx = pose_x_ + cos_yaw_ * p.x - sin_yaw_ * p.y;
+            const float wy = pose_y_ + sin_yaw_ * p.x + cos_yaw_ * p.y;
+            const int gx = cellOf(wx), gy = cellOf(wy);
+            if (!inWindow(gx, gy)) continue;
+
+            const int i = index(gx, gy);
+            const int z = static_cast<int>(std::lround(p.z));
+            if (i != cur) {
+                if (cur >= 0) { flush(cur, acc, now); ++writes; }
+                cur = i;
+                acc = Acc{z, z, 0, 0};
+            }
+            acc.z_min = std::min(acc.z_min, z);
+            acc.z_max = std::max(acc.z_max, z);
+            acc.sum += z;
+            ++acc.n;
+        }
+        if (cur >= 0) { flush(cur, acc, now); ++writes; }
+        return writes;
+    }
+
+    // Buňky bez zásahu déle než kWindowTicks pryč (jednou za otáčku).
+    void expire(std::uint16_t now)
+    {
+        for (Cell &c : cells_) {
+            if (c.n > 0 && static_cast<std::uint16_t>(now - c.t_last) > kWindowTicks) c = Cell{};
+        }
+    }
+
+    void snapshot(Snapshot &out, std::uint32_t rev) const
+    {
+        const int ox = center_cx_ - kSize / 2;
+        const int oy = center_cy_ - kSize / 2;
+        out.meta.size      = kSize;
+        out.meta.cell_cm   = kCellCm;
+        out.meta.origin_cx = ox;
+        out.meta.origin_cy = oy;
+        out.meta.pose_x_cm = pose_x_;
+        out.meta.pose_y_cm = pose_y_;
+        out.meta.pose_yaw  = pose_yaw_;
+        out.meta.rev       = rev;
+        out.z_min.resize(kCells);
+        out.z_max.resize(kCells);
+        out.z_mean.resize(kCells);
+
+        for (int r = 0; r < kSize; ++r) {
+            const int row = mod(oy + r) * kSize;
+            for (int c = 0; c < kSize; ++c) {
+                const Cell &cell = cells_[row + mod(ox + c)];
+                const int k = r * kSize + c;
+                if (cell.n == 0) {
+                    out.z_min[k] = out.z_max[k] = out.z_mean[k] = kEmpty;
+                } else {
+                    out.z_min[k]  = cell.z_min;
+                    out.z_max[k]  = cell.z_max;
+                    out.z_mean[k] = static_cast<std::int16_t>(cell.sum / static_cast<std::int32_t>(cell.n));
+                }
+            }
+        }
+    }
+
+    // Velikost kompaktního exportu (Meta + 3 × kCells int16).
+    static constexpr std::size_t kExportBytes = sizeof(Meta) + 3 * kCells * sizeof(std::int16_t);
+
+    static void exportTo(const Snapshot &s, std::uint8_t *dst)
+    {
+        std::memcpy(dst, &s.meta, sizeof(Meta));
+        dst += sizeof(Meta);
+        std::memcpy(dst, s.z_min.data(), kCells * sizeof(std::int16_t));
+        dst += kCells * sizeof(std::int16_t);
+        std::memcpy(dst, s.z_max.data(), kCells * sizeof(std::int16_t));
+        dst += kCells * sizeof(std::int16_t);
+        std::memcpy(dst, s.z_mean.data(), kCells * sizeof(std::int16_t));
+    }
+
+    // Skóre průjezdnosti buňky snapshotu (c, r) – líně, jen na dotaz.
+    static std::uint8_t score(const Snapshot &s, int c, int r)
+    {
+        const int k = r * kSize + c;
+        if (s.z_mean[k] == kEmpty) return kUnknown;
+
+        const float m = s.z_mean[k];
+        float worst = (s.z_max[k] - s.z_min[k]) / kMaxRoughCm;
+
+        // schod vůči 8 sousedům + součty pro rovinu z = a + b·dc + c·dr
+        float n = 0.0f, sx = 0.0f, sy = 0.0f, sz = 0.0f;
+        float sxx = 0.0f, syy = 0.0f, sxy = 0.0f, sxz = 0.0f, syz = 0.0f;
+        for (int dr = -kSlopeRadius; dr <= kSlopeRadius; ++dr) {
+            const int rr = r + dr;
+            if (rr < 0 || rr >= kSize) continue;
+            for (int dc = -kSlopeRadius; dc <= kSlopeRadius; ++dc) {
+                const int cc = c + dc;
+                if (cc < 0 || cc >= kSize) continue;
+                const std::int16_t mn = s.z_mean[rr * kSize + cc];
+                if (mn == kEmpty) continue;
+                const float z = mn - m;
+                if (std::abs(dr) <= 1 && std::abs(dc) <= 1) {
+                    worst = std::max(worst, std::fabs(z) / kMaxStepCm);
+                }
+                const float x = static_cast<float>(dc), y = static_cast<float>(dr);
+                n += 1.0f; sx += x; sy += y; sz += z;
+                sxx += x * x; syy += y * y; sxy += x * y; sxz += x * z; syz += y * z;
+            }
+        }
+
+        // sklon = |gradient| roviny nejmenších čtverců [cm/cm]
+        if (n >= kMinFitCells) {
+            const float cxx = sxx - sx * sx / n, cyy = syy - sy * sy / n, cxy = sxy - sx * sy / n;
+            const float cxz = sxz - sx * sz / n, cyz = syz - sy * sz / n;
+            const float det = cxx * cyy - cxy * cxy;
+            if (det > 1e-3f) {
+                const float gx = (cxz * cyy - cyz * cxy) / det;
+                const float gy = (cyz * cxx - cxz * cxy) / det;
+                worst = std::max(worst, std::sqrt(gx * gx + gy * gy) / kCellCm / kMaxSlope);
+            }
+        }
+        const float v = worst * kBlocked;
+        return static_cast<std::uint8_t>(v >= kBlocked ? kBlocked : v);
+    }
+
+    // Průjezdnost kruhu o poloměru radius_cm kolem bodu [cm, rámec robota].
+    static Region region(const Snapshot &s, float x_cm, float y_cm, float radius_cm)
+    {
+        const auto &m = s.meta;
+        const float c = std::cos(m.pose_yaw), sn = std::sin(m.pose_yaw);
+        const float wx = m.pose_x_cm + c * x_cm - sn * y_cm;
+        const float wy = m.pose_y_cm + sn * x_cm + c * y_cm;
+        const float fx = wx / m.cell_cm - m.origin_cx;   // spojitý index sloupce
+        const float fy = wy / m.cell_cm - m.origin_cy;
+        const float rc = radius_cm / m.cell_cm;
+
+        Region out;
+        float sum = 0.0f;
+        const int c0 = std::max(0, static_cast<int>(std::floor(fx - rc)));
+        const int c1 = std::min(kSize - 1, static_cast<int>(std::floor(fx + rc)));
+        const int r0 = std::max(0, static_cast<int>(std::floor(fy - rc)));
+        const int r1 = std::min(kSize - 1, static_cast<int>(std::floor(fy + rc)));
+        for (int r = r0; r <= r1; ++r) {
+            for (int cc = c0; cc <= c1; ++cc) {
+                const float dx = cc + 0.5f - fx, dy = r + 0.5f - fy;
+                if (dx * dx + dy * dy > rc * rc) continue;
+                ++out.total;
+                const std::uint8_t v = score(s, cc, r);
+                if (v == kUnknown) continue;
+                ++out.known;
+                sum += v;
+                out.worst = out.worst == kUnknown ? v : std::max(out.worst, v);
+            }
+        }
+        out.mean = out.known ? sum / out.known : 0.0f;
+        return out;
+    }
+
+private:
+    struct Cell {
+        std::int16_t  z_min = 0;
+        std::int16_t  z_max = 0;
+        std::int32_t  sum = 0;
+        std::uint16_t n = 0;
+        std::uint16_t t0 = 0;      // začátek okna buňky (tiky)
+        std::uint16_t t_last = 0;  // poslední zásah (expire)
+    };
+
+    struct Acc {
+        int z_min, z_max;
+        int sum;
+        int n;
+    };
+
+    void flush(int i, const Acc &a, std::uint16_t now)
+    {
+        Cell &c = cells_[i];
+        if (c.n == 0 || static_cast<std::uint16_t>(now - c.t0) > kWindowTicks) {
+            c.z_min = static_cast<std::int16_t>(a.z_min);
+            c.z_max = static_cast<std::int16_t>(a.z_max);
+            c.sum = a.sum;
+            c.n = static_cast<std::uint16_t>(a.n);
+            c.t0 = c.t_last = now;
+            return;
+        }
+        c.t_last = now;
+        c.z_min = static_cast<std::int16_t>(std::min<int>(c.z_min, a.z_min));
+        c.z_max = static_cast<std::int16_t>(std::max<int>(c.z_max, a.z_max));
+        if (c.n + a.n > 0xFFFF) {     // saturace: průměr zachovat, váhu polovit
+            c.sum /= 2;
+            c.n /= 2;
+        }
+        c.sum += a.sum;
+        c.n = static_cast<std::uint16_t>(c.n + a.n);
+    }
+
+    static inline int cellOf(float cm)
+    {
+        return static_cast<int>(std::floor(cm / kCellCm));
+    }
+
+    static inline int mod(int v)
+    {
+        const int m = v % kSize;
+        return m < 0 ? m + kSize : m;
+    }
+
+    inline bool inWindow(int gx, int gy) const
+    {
+        return gx >= center_cx_ - kSize / 2 && gx < center_cx_ + kSize / 2 &&
+               gy >= center_cy_ - kSize / 2 && gy < center_cy_ + kSize / 2;
+    }
+
+    static inline int index(int gx, int gy) { return mod(gy) * kSize + mod(gx); }
+
+    // Posun okna: vynuluj jen buňky, které do okna nově vstupují.
+    void scrollTo(int cx, int cy)
+    {
+        const int dx = cx - center_cx_;
+        const int dy = cy - center_cy_;
+        if (dx == 0 && dy == 0) return;
+
+        if (std::abs(dx) >= kSize || std::abs(dy) >= kSize) {
+            for (auto &c : cells_) c = Cell{};
+        } else {
+            for (int k = 0; k < std::abs(dx); ++k) {
+                const int col = mod(dx > 0 ? center_cx_ + kSize / 2 + k
+                                           : center_cx_ - kSize / 2 - 1 - k);
+                for (int r = 0; r < kSize; ++r) cells_[r * kSize + col] = Cell{};
+            }
+            for (int k = 0; k < std::abs(dy); ++k) {
+                const int row = mod(dy > 0 ? center_cy_ + kSize / 2 + k
+                                           : center_cy_ - kSize / 2 - 1 - k);
+                std::fill_n(&cells_[row * kSize], kSize, Cell{});
+            }
+        }
+        center_cx_ = cx;
+        center_cy_ = cy;
+    }
+
+    std::array<Cell, kCells> cells_{};
+
+    float pose_x_{0.0f}, pose_y_{0.0f}, pose_yaw_{0.0f};
+    float cos_yaw_{1.0f}, sin_yaw_{0.0f};
+    int   center_cx_{0}, center_cy_{0};
+};
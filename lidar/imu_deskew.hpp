@@ -0,0 +1,191 @@
+#pragma once
+
+// imu_deskew.hpp — integrace gyra z IMU LiDARu a deskew bodů
+// ---------------------------------------------------------------------------
+// • ImuHistory: krátká historie orientací (kCapacity vzorků, ~1 s při 250 Hz)
+//   integrovaných z angular_velocity. Kvaternion ze SDK se nepoužívá
+//   (nejasné pořadí wxyz/xyzw, viz statistika v processIMUData) – stačí nám
+//   relativní rotace, tu dává gyro.
+// • Lock-free: jeden zapisovatel (loopRead), čtenáři kdekoli. Slot se zapíše
+//   celý a až pak se release-storem posune head_; čtenář si vezme head_
+//   (acquire) a čte jen sloty za ním (starší než kCapacity - kGuard vzorků
+//   nečte, ty může zapisovatel právě přepisovat).
+// • Bias gyra: pomalý průměr vzorků, kdy robot stojí (|ω| < kStillRad).
+// • orientation(t): slerp mezi sousedními vzorky, za posledním vzorkem
+//   extrapolace posledním ω.
+// • yaw: navíc se integruje rotace kolem svislé osy robota (yaw_axis_ =
+//   osa z robota vyjádřená v rámci LiDARu, nastaví setYawAxis()) – pro
+//   odhad pohybu robota (ego_motion.hpp).
+// • deskewFor(): rotace R0 (první bod linie) a dR (změna přes linii) do
+//   referenčního času t_ref, pro RangeImage::decodeInto. Body se natočí
+//   v rámci LiDARu (IMU je v těle LiDARu, osy shodné).
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+// Rotace bodů linie: R(u) ≈ R0 + dR·u, u ∈ [0,1] od prvního k poslednímu bodu.
+struct LineDeskew
+{
+    bool            enabled = false;
+    Eigen::Matrix3f R0 = Eigen::Matrix3f::Identity();
+    Eigen::Matrix3f dR = Eigen::Matrix3f::Zero();
+};
+
+class ImuHistory
+{
+public:
+    static constexpr std::uint32_t kCapacity = 256;      // mocnina 2
+    static constexpr std::uint32_t kGuard    = 16;       // sloty, které čtenář nečte
+    static constexpr float kStillRad   = 0.02f;          // [rad/s]
+    static constexpr float kBiasAlpha  = 0.002f;
+
+    struct State {
+        double              stamp = 0.0;     // [s], systémový čas přijetí
+        Eigen::Quaternionf  q = Eigen::Quaternionf::Identity();  // integrovaná orientace
+        Eigen::Vector3f     w = Eigen::Vector3f::Zero();         // ω bez biasu [rad/s]
+        double              yaw = 0.0;       // integrovaný yaw robota [rad]
+    };
+
+    // Svislá osa robota v rámci LiDARu (jednotkový vektor).
+    void setYawAxis(const Eigen::Vector3f &axis) { yaw_axis_ = axis.normalized(); }
+
+    void clear()
+    {
+        head_.store(0, std::memory_order_release);
+        bias_.setZero();
+    }
+
+    // Nový IMU vzorek (jen vlákno loopRead).
+    void push(double stamp, const float gyro[3])
+    {
+        Eigen::Vector3f w_raw(gyro[0], gyro[1], gyro[2]);
+        if (w_raw.norm() < kStillRad) {
+            bias_ += kBiasAlpha * (w_raw - bias_);
+        }
+        const Eigen::Vector3f w = w_raw - bias_;
+
+        const std::uint32_t h = head_.load(std::memory_order_relaxed);
+        State s;
+        s.stamp = stamp;
+        s.w = w;
+        if (h == 0) {
+            s.q.setIdentity();
+            s.yaw = 0.0;
+        } else {
+            const State &prev = ring_[(h - 1) & (kCapacity - 1)];
+            const float dt = static_cast<float>(stamp - prev.stamp);
+            const bool ok = dt > 0.0f && dt < 0.1f;
+            const Eigen::Vector3f w_mid = 0.5f * (prev.w + w);
+            s.q = ok ? (prev.q * deltaQ(w_mid, dt)).normalized() : prev.q;
+            s.yaw = prev.yaw + (ok ? static_cast<double>(yaw_axis_.dot(w_mid) * dt) : 0.0);
+        }
+        ring_[h & (kCapacity - 1)] = s;
+        head_.store(h + 1, std::memory_order_release);
+    }
+
+    bool empty() const { return head_.load(std::memory_order_acquire) == 0; }
+
+    // Čas nejnovějšího vzorku; 0 pokud žádný.
+    double latestStamp() const
+    {
+        const std::uint32_t h = head_.load(std::memory_order_acquire);
+        return h ? ring_[(h - 1) & (kCapacity - 1)].stamp : 0.0;
+    }
+
+    // Orientace v čase t (integrovaný rámec). false = bez dat.
+    bool orientation(double t, Eigen::Quaternionf &q_out) const
+    {
+        const std::uint32_t h = head_.load(std::memory_order_acquire);
+        if (h == 0) return false;
+
+        const std::uint32_t avail = h < kCapacity - kGuard ? h : kCapacity - kGuard;
+        const State &last = ring_[(h - 1) & (kCapacity - 1)];
+
+        if (t >= last.stamp) {
+            const float dt = static_cast<float>(t - last.stamp);
+            q_out = (dt < 0.1f) ? (last.q * deltaQ(last.w, dt)).normalized() : last.q;
+            return true;
+        }
+
+        // od nejnovějšího dozadu (hledáme kousek historie, typicky pár kroků)
+        for (std::uint32_t k = 1; k < avail; ++k) {
+            const State &a = ring_[(h - 1 - k) & (kCapacity - 1)];
+            const State &b = ring_[(h - k) & (kCapacity - 1)];
+            if (t >= a.stamp) {
+                const double span = b.stamp - a.stamp;
+                const float u = span > 0.0 ? static_cast<float>((t - a.stamp) / span) : 0.0f;
+                q_out = a.q.slerp(u, b.q);
+                return true;
+            }
+        }
+        q_out = ring_[(h - avail) & (kCapacity - 1)].q;  // starší než historie
+        return true;
+    }
+
+    // Integrovaný yaw robota v čase t [rad]. false = bez dat.
+    bool yawAt(double t, double &yaw_out) const
+    {
+        const std::uint32_t h = head_.load(std::memory_order_acquire);
+        if (h == 0) return false;
+
+        const std::uint32_t avail = h < kCapacity - kGuard ? h : kCapacity - kGuard;
+        const State &last = ring_[(h - 1) & (kCapacity - 1)];
+
+        if (t >= last.stamp) {
+            const double dt = t - last.stamp;
+            yaw_out = last.yaw + (dt < 0.1 ? yaw_axis_.dot(last.w) * dt : 0.0);
+            return true;
+        }
+        for (std::uint32_t k = 1; k < avail; ++k) {
+            const State &a = ring_[(h - 1 - k) & (kCapacity - 1)];
+            const State &b = ring_[(h - k) & (kCapacity - 1)];
+            if (t >= a.stamp) {
+                const double span = b.stamp - a.stamp;
+                const double u = span > 0.0 ? (t - a.stamp) / span : 0.0;
+                yaw_out = a.yaw + u * (b.yaw - a.yaw);
+                return true;
+            }
+        }
+        yaw_out = ring_[(h - avail) & (kCapacity - 1)].yaw;
+        return true;
+    }
+
+    // Deskew linie: body v čase t0 .. t0 + span → do času t_ref.
+    LineDeskew deskewFor(double t0, double span, double t_ref) const
+    {
+        LineDeskew d;
+        Eigen::Quaternionf q0, q1, qr;
+        if (!orientation(t0, q0) || !orientation(t0 + span, q1) || !orientation(t_ref, qr)) {
+            return d;
+        }
+        const Eigen::Quaternionf qr_inv = qr.conjugate();
+        const Eigen::Matrix3f R0 = (qr_inv * q0).toRotationMatrix();
+        const Eigen::Matrix3f R1 = (qr_inv * q1).toRotationMatrix();
+        d.enabled = true;
+        d.R0 = R0;
+        d.dR = R1 - R0;
+        return d;
+    }
+
+    const Eigen::Vector3f &bias() const { return bias_; }
+
+private:
+    static Eigen::Quaternionf deltaQ(const Eigen::Vector3f &w, float dt)
+    {
+        const Eigen::Vector3f th = w * dt;
+        const float a = th.norm();
+        if (a < 1e-9f) return Eigen::Quaternionf::Identity();
+        return Eigen::Quaternionf(Eigen::AngleAxisf(a, th / a));
+    }
+
+    std::array<State, kCapacity> ring_{};
+    std::atomic<std::uint32_t>   head_{0};
+    Eigen::Vector3f              bias_ = Eigen::Vector3f::Zero();   // jen zapisovatel
+    Eigen::Vector3f              yaw_axis_ = Eigen::Vector3f::UnitZ();
+};
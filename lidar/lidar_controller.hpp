@@ -6,14 +6,40 @@
 //     raw_logger_  → /data/robot/lidar/cloud_*.ply (syrový cloud)
 //     proc_logger_ → /data/robot/lidar/trans_*.ply (transform + ořez)
 // • loopRead():
-//     - pro cloud:
+//     - každý paket → LidarRawLogger (L2RAW03, asynchronní zápis komprimovaných bloků),
+//       jen když je průběžný log zapnutý (TCP RAWLOG ON/OFF) a StorageManager
+//       ho nevypnul (zap/vyp jen přepne příznak, soubory otevírá a zavírá
+//       zapisovač); rotace po kRawFileBytes / kRawFileNs, při nedostatku
+//       místa se nejdřív vypnou PLY dumpy, pak se decimuje, pak raw log stop
+//     - každý paket → BlackBoxRecorder (posledních ~35 s v RAM, uloží se
+//       okno kolem události: TCP TRIGGER nebo narušení bezpečné zóny)
+//     - pro point paket: dekódování přímo do range image (LidarPointProcessing)
+//     - původně pro cloud:
 //         1. uloží syrový cloud (raw_logger_)
 //         2. vytvoří transformovaný cloud (pointproc::transformCloud)
 //         3. uloží transformovaný cloud (proc_logger_)
 //         4. minimum počítá z transformovaného cloudu (pointproc::minDistance)
+//     - po každé otáčce (přetečení com_horizontal_angle_start):
+//         onRevolution() → CorridorFinder, výsledek se cachuje pro klienty
+//                        → decay + snapshot mřížky obsazenosti (TCP GRID,
+//                          shared memory /robot_lidar_grid)
+//                        → distanční transformace mřížky (TCP CLEARANCE,
+//                          shared memory /robot_lidar_clearance)
+//                        → expirace + snapshot výškové mapy (TCP HEIGHTMAP / TRAVERSE,
+//                          shared memory /robot_lidar_heightmap)
+//                        → normály předplacených výřezů range image (TCP NORMALS)
+//                        → shlukování překážek nad mřížkou (TCP OBJECTS)
+//                        → sledování objektů, rychlost a nejbližší
+//                          přiblížení (TCP TRACKS)
+//                        → cloud otáčky pro odběratele náhledu (TCP
+//                          SUBSCRIBE CLOUD, voxelizuje klientské vlákno)
+//                        → výsledky otáčky jako anotace do black boxu,
+//                          překážka blíž než kSafetyBreachCm od obrysu
+//                          robota = trigger (max. jednou za kBreachHoldoffNs)
 //     - pro IMU:
 //         1. po přijetí IMU paketu zavolá getImuData()
-//         2. vypíše IMU hodnoty na stdout
+//         2. gyro → ImuHistory (deskew bodů v LidarPointProcessing)
+//         3. statistika IMU na stdout každých ~10 s
 //
 // Design:
 //   - reader_ + UDP socket se inicializují jen jednou (initializeUDP).
@@ -28,6 +54,7 @@
 #include <iostream>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
 #include <limits>
 #include <cstdint>
 #include <iomanip>
@@ -38,8 +65,19 @@
 #include "unitree_lidar_protocol.h"
 
 #include "point_processing.hpp"
+#include "corridor_finder.hpp"
+#include "occupancy_grid.hpp"
+#include "distance_transform.hpp"
+#include "obstacle_clusters.hpp"
+#include "object_tracker.hpp"
+#include "surface_normals.hpp"
+#include "parallel_for.hpp"
+#include "shm_publisher.hpp"
 //#include "ply_logger.hpp"
 #include "raw_logger.hpp"
+#include "black_box.hpp"
+#include "storage_manager.hpp"
+#include "cloud_stream.hpp"
 
 namespace unilidar = unilidar_sdk2;
 
@@ -109,6 +147,7 @@ public:
                 std::lock_guard<std::mutex> lg(mtx_);
                 //resetDistance();
                 //points_->clear();
+                resetRevolution();
                 running_.store(true, std::memory_order_relaxed);
                 worker_ = std::thread(&LidarController::loopRead, this);
             }
@@ -141,6 +180,7 @@ public:
         if (worker_.joinable()) {
             worker_.join();
         }
+        black_box_.flush();   // otevřené okno black boxu uložit hned
 
         // 3) zastav rotaci (reader_ stále žije, UDP necháme být)
         try {
@@ -158,6 +198,7 @@ public:
             //resetDistance();
             point_processing_.clear();
         }
+        resetRevolution();
 
         std::cout << "[LIDAR] stopped" << std::endl;
     }
@@ -215,6 +256,221 @@ public:
         return dist_out < 0 ? false : true;
     }
 
+    // Parametrizovaný dotaz (z-pásmo, azimut, stáří, footprint, P/K).
+    // Výsledek se cachuje podle (dotaz, slot dat = kEpochPackets paketů) →
+    // stejný dotaz od více klientů se v rámci slotu počítá jednou.
+    bool getDistance(const DistanceQuery &q, float &dist_out) {
+        dist_out = query_cache_.get(q, point_processing_.epoch(), [this](const DistanceQuery &qq) {
+            return point_processing_.distance(qq, unilidar::getSystemTimeStamp());
+        });
+        return dist_out < 0 ? false : true;
+    }
+
+    // Robustní dotaz (P/K) po sektorech DistanceHistogram (-1 = sektor nemá dost bodů).
+    void getDistanceSectors(const DistanceQuery &q,
+                            std::array<float, DistanceHistogram::kSectors> &sectors) const {
+        const DistanceHistogram &h = point_processing_.distanceHistogram();
+        for (int s = 0; s < DistanceHistogram::kSectors; ++s) {
+            sectors[s] = q.kth > 0 ? h.kth(q.kth, s, s) : h.percentile(q.percentile, s, s);
+        }
+    }
+
+    // Poslední spočtené koridory (jednou za otáčku).
+    // false = zatím nic (LiDAR neběží nebo ještě neproběhla celá otáčka).
+    bool getCorridors(CorridorSet &out) const {
+        std::shared_ptr<const CorridorSet> c;
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            c = corridors_;
+        }
+        if (!c || !running_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        out = *c;
+        return true;
+    }
+
+    // Poslední seznam objektů (shluky překážek, jednou za otáčku).
+    bool getObjects(ObjectList &out) const {
+        std::shared_ptr<const ObjectList> o;
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            o = objects_;
+        }
+        if (!o || !running_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        out = *o;
+        return true;
+    }
+
+    // Potvrzené tracky pohyblivých objektů z poslední otáčky.
+    bool getTracks(TrackList &out) const {
+        std::shared_ptr<const TrackList> t;
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            t = tracks_;
+        }
+        if (!t || !running_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        out = *t;
+        return true;
+    }
+
+    // Totéž bez kopie – sdílené snapshoty pro binární režim TCP (binary_protocol.hpp).
+    bool getCorridors(std::shared_ptr<const CorridorSet> &out) const {
+        return getShared(corridors_, out);
+    }
+
+    bool getObjects(std::shared_ptr<const ObjectList> &out) const {
+        return getShared(objects_, out);
+    }
+
+    bool getTracks(std::shared_ptr<const TrackList> &out) const {
+        return getShared(tracks_, out);
+    }
+
+    bool getClearanceMap(std::shared_ptr<const DistanceTransform::Result> &out) const {
+        return getShared(clearance_, out);
+    }
+
+    // Poslední snapshot mřížky obsazenosti (jednou za otáčku).
+    bool getGrid(std::shared_ptr<const EgoOccupancyGrid::Snapshot> &out) const {
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            out = grid_snapshot_;
+        }
+        return out && running_.load(std::memory_order_relaxed);
+    }
+
+    // Poslední snapshot výškové mapy (jednou za otáčku).
+    bool getHeightMap(std::shared_ptr<const HeightMap::Snapshot> &out) const {
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            out = height_snapshot_;
+        }
+        return out && running_.load(std::memory_order_relaxed);
+    }
+
+    // Průjezdnost kruhu kolem bodu x,y [cm, rámec robota], skóre se počítá jen pro něj.
+    bool getTraversability(float x_cm, float y_cm, float radius_cm,
+                           uint32_t &rev_out, HeightMap::Region &out) const {
+        std::shared_ptr<const HeightMap::Snapshot> h;
+        if (!getHeightMap(h)) {
+            return false;
+        }
+        rev_out = h->meta.rev;
+        out = HeightMap::region(*h, x_cm, y_cm, radius_cm);
+        return out.total > 0;
+    }
+
+    // Normály povrchu ve výřezu horizontálních úhlů LiDARu [deg].
+    // Zároveň výřez předplatí (počítá se od další otáčky, kSubscriptionRevs otáček).
+    bool getNormals(float from_deg, float to_deg, NormalSet &out) {
+        std::shared_ptr<const NormalSet> ns;
+        uint64_t rev = 0;
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            ns = normals_;
+            if (grid_snapshot_) rev = grid_snapshot_->meta.rev;
+        }
+        normal_estimator_.subscribe(from_deg, to_deg, rev);
+        if (!ns || !running_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        int r0 = 0, r1 = 0;
+        NormalEstimator::rowRange(from_deg, to_deg, r0, r1);
+        out.rev = ns->rev;
+        out.rows.clear();
+        for (const auto &row : ns->rows) {
+            if (NormalSet::inRange(row.row, r0, r1)) out.rows.push_back(row);
+        }
+        return true;
+    }
+
+    // Vzorek odometrie od klienta (pilot / fusion) v odometrickém rámci.
+    void setOdometry(float x_cm, float y_cm, float yaw_rad) {
+        point_processing_.updateOdom(unilidar::getSystemTimeStamp(),
+                                     Pose2D{x_cm, y_cm, yaw_rad});
+    }
+
+    // Cena stupňů zpracování (TCP STATS), jeden řádek.
+    std::string statsLine() const {
+        return point_processing_.groundStats().toString("ground") + " | " +
+               point_processing_.deskewStats().toString("deskew") + " | " +
+               point_processing_.outlierStats().toString("outlier") + " | " +
+               point_processing_.outlierFilter().toString("outliers") + " | " +
+               point_processing_.negativeStats().toString("negative") + " | " +
+               point_processing_.heightStats().toString("heightmap") + " | " +
+               normal_stats_.toString("normals") + " | " +
+               cluster_stats_.toString("clusters") + " | " +
+               tracker_stats_.toString("tracker") + " | " +
+               query_cache_.toString("distance_cache") + " | " +
+               raw_log_stats_.toString("rawlog") + " | " +
+               black_box_.toString("blackbox") + " | " +
+               storage_.toString("storage") + " | " +
+               cloud_stream_.toString("cloudstream");
+    }
+
+    // Odběr náhledového cloudu (TCP SUBSCRIBE CLOUD); bez odběratelů se snapshot nestaví.
+    void subscribeCloud(bool on) {
+        if (on) {
+            cloud_stream_.subscribers.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            cloud_stream_.subscribers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Čeká na cloud otáčky novější než after_rev (max. timeout_ms).
+    // false = nic nového (LiDAR stojí nebo ještě neproběhla otáčka).
+    bool waitCloud(uint64_t after_rev, int timeout_ms,
+                   std::shared_ptr<const CloudSnapshot> &out) const {
+        std::unique_lock<std::mutex> lk(result_mtx_);
+        cloud_cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms),
+                           [&] { return cloud_ && cloud_->rev > after_rev; });
+        if (!cloud_ || cloud_->rev <= after_rev) {
+            return false;
+        }
+        out = cloud_;
+        return true;
+    }
+
+    CloudStreamStats &cloudStreamStats() { return cloud_stream_; }
+
+    // Uložení okna black boxu kolem této chvíle. false = okno už je otevřené.
+    bool triggerBlackBox(const std::string &reason) {
+        return black_box_.trigger(reason);
+    }
+
+    // Průběžný raw log (LidarRawLogger) zap/vyp; projeví se s dalším paketem,
+    // soubor otevře / zavře vlákno zapisovače (TCP ani loopRead nečeká).
+    void setRawLogEnabled(bool on) {
+        raw_log_enabled_.store(on, std::memory_order_relaxed);
+    }
+
+    bool rawLogEnabled() const {
+        return raw_log_enabled_.load(std::memory_order_relaxed);
+    }
+
+    const std::string &gridShmName() const { return grid_shm_.name(); }
+
+    // Clearance (vzdálenost k nejbližší obsazené buňce) v bodě x,y [cm, rámec robota].
+    // false = distanční transformace zatím není nebo je bod mimo mřížku.
+    bool getClearance(float x_cm, float y_cm, uint32_t &rev_out, float &clear_out) const {
+        std::shared_ptr<const DistanceTransform::Result> c;
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            c = clearance_;
+        }
+        if (!c || !running_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        rev_out   = c->meta.rev;
+        clear_out = DistanceTransform::lookup(*c, x_cm, y_cm);
+        return clear_out >= 0.0f;
+    }
+
 
 private:
     // RAII deleter pro UnitreeLidarReader (SDK2)
@@ -263,17 +519,15 @@ private:
 
     // ----------------------------- zpracování dat -----------------------------
 
-    // Zpracování point cloudu (původní logika z loopRead)
-    void processCloudData(unilidar::UnitreeLidarReader &r,
+    // Zpracování point paketu (původní logika z loopRead).
+    // Paket se dekóduje rovnou do range image (bez PointCloudUnitree z SDK).
+    void processCloudData(const unilidar::LidarPointDataPacket &pkt,
                           float &rev_min,
                           std::chrono::steady_clock::time_point &t_end)
     {
-        unilidar::PointCloudUnitree cloud;
-        if (!r.getPointCloud(cloud)) {
-            return;
-        }
-
-        point_processing_.updateCloud(cloud);
+        // čas začátku linie stejně jako SDK s use_system_timestamp = true
+        const double stamp = unilidar::getSystemTimeStamp() - pkt.data.scan_period;
+        point_processing_.updatePacket(pkt, stamp, static_cast<uint32_t>(rev_seq_));
 
         // --- RAW log ---
         //raw_logger_.push(cloud);
@@ -316,6 +570,9 @@ private:
             static_cast<double>(info.stamp.nsec) / 1.0e9;
         const double sys_ts = unilidar::getSystemTimeStamp();
 
+        // ---- integrace gyra pro deskew (stejná časová osa jako linie) ----
+        point_processing_.updateImu(imu, sys_ts);
+
         // ---- Původní raw log (můžeš klidně ponechat nebo omezit) ----
         /*
         std::cout << std::fixed << std::setprecision(9);
@@ -486,14 +743,193 @@ private:
         }
     }
 
+    // ----------------------------- otáčky -----------------------------------
+
+    // Detekce konce otáčky z horizontálního úhlu paketu (přetečení 2π → 0).
+    // Pojistka: když se úhel nepřetočí do kRevTimeout, bereme to jako otáčku,
+    // aby cache nezůstala stará.
+    bool updateRevolution(const unilidar::LidarPointDataPacket &pkt, uint64_t mono_ts_ns) {
+        constexpr uint64_t kRevTimeoutNs = 1'000'000'000ull;
+        const float angle = pkt.data.com_horizontal_angle_start;
+
+        bool wrapped = false;
+        if (rev_start_ns_ == 0) {
+            rev_start_ns_ = mono_ts_ns;
+        } else if (angle < last_h_angle_ - static_cast<float>(M_PI)) {
+            wrapped = true;
+        } else if (mono_ts_ns - rev_start_ns_ > kRevTimeoutNs) {
+            wrapped = true;
+        }
+        last_h_angle_ = angle;
+
+        if (wrapped) {
+            rev_start_ns_ = mono_ts_ns;
+            ++rev_seq_;
+        }
+        return wrapped;
+    }
+
+    // Výpočty "jednou za otáčku" – běží ve vlákně loopRead.
+    void onRevolution(uint64_t mono_ts_ns) {
+        const double now = unilidar::getSystemTimeStamp();
+
+        // --- mřížka obsazenosti: decay + snapshot + export ---
+        EgoOccupancyGrid &grid = point_processing_.grid();
+        grid.decay(EgoOccupancyGrid::ticks(now));
+
+        auto g = std::make_shared<EgoOccupancyGrid::Snapshot>();
+        grid.snapshot(*g, static_cast<uint32_t>(rev_seq_));
+        grid_shm_.publish(mono_ts_ns, [&](uint8_t *dst) {
+            std::memcpy(dst, &g->meta, sizeof(g->meta));
+            std::memcpy(dst + sizeof(g->meta), g->hits.data(), g->hits.size());
+        });
+
+        // --- výšková mapa: snapshot + kompaktní export ---
+        HeightMap &height = point_processing_.heightMap();
+        height.expire(EgoOccupancyGrid::ticks(now));
+        auto hm = std::make_shared<HeightMap::Snapshot>();
+        height.snapshot(*hm, static_cast<uint32_t>(rev_seq_));
+        height_shm_.publish(mono_ts_ns, [&](uint8_t *dst) { HeightMap::exportTo(*hm, dst); });
+
+        // --- normály jen pro předplacené řádky range image ---
+        auto ns = std::make_shared<NormalSet>();
+        {
+            StageTimer t(normal_stats_, 0);
+            normal_estimator_.update(point_processing_.rangeImage(), rev_seq_, *ns);
+        }
+
+        // --- distanční transformace (paralelně přes řádky/sloupce) ---
+        auto dt = std::make_shared<DistanceTransform::Result>();
+        edt_.compute(*g, *dt);
+        clearance_shm_.publish(mono_ts_ns, [&](uint8_t *dst) {
+            std::memcpy(dst, &dt->meta, sizeof(dt->meta));
+            std::memcpy(dst + sizeof(dt->meta), dt->clearance_cm.data(),
+                        dt->clearance_cm.size() * sizeof(float));
+        });
+
+        // --- koridory + objekty (potřebují plný buffer) ---
+        std::shared_ptr<CorridorSet> c;
+        std::shared_ptr<ObjectList>  o;
+        std::shared_ptr<TrackList>   tr;
+        if (point_processing_.full()) {
+            EgoCompensator comp = point_processing_.compensator();
+            c = std::make_shared<CorridorSet>(
+                corridor_finder_.compute(point_processing_.data(),
+                                         LidarPointProcessing::kCapacity,
+                                         comp,
+                                         rev_seq_,
+                                         now));
+
+            o = std::make_shared<ObjectList>();
+            {
+                StageTimer t(cluster_stats_, LidarPointProcessing::kCapacity);
+                clustering_.compute(*g, point_processing_.data(),
+                                    LidarPointProcessing::kCapacity,
+                                    comp, rev_seq_, now, *o);
+            }
+
+            tr = std::make_shared<TrackList>();
+            StageTimer t(tracker_stats_, o->objects.size());
+            tracker_.update(*o, Pose2D{g->meta.pose_x_cm, g->meta.pose_y_cm, g->meta.pose_yaw}, *tr);
+        }
+
+        // --- cloud dokončené otáčky pro náhled (jen s odběrateli) ---
+        std::shared_ptr<CloudSnapshot> cl;
+        if (cloud_stream_.subscribers.load(std::memory_order_relaxed) > 0) {
+            cl = std::make_shared<CloudSnapshot>();
+            cl->rev = rev_seq_;
+            cl->stamp_ns = mono_ts_ns;
+            StageTimer t(cloud_stream_.build, RangeImage::kRows);
+            // řádky dokončené otáčky nesou ještě předchozí rev_seq_ (viz updateRevolution)
+            cl->build(point_processing_.rangeImage(), static_cast<uint32_t>(rev_seq_ - 1));
+        }
+        const bool cloud_ready = cl != nullptr;
+
+        recordRevolution(mono_ts_ns, now, c.get(), o.get(), tr.get());
+
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            grid_snapshot_ = std::move(g);
+            height_snapshot_ = std::move(hm);
+            normals_       = std::move(ns);
+            clearance_     = std::move(dt);
+            if (c) corridors_ = std::move(c);
+            if (o) objects_   = std::move(o);
+            if (tr) tracks_   = std::move(tr);
+            if (cl) cloud_    = std::move(cl);
+        }
+        if (cloud_ready) cloud_cv_.notify_all();
+    }
+
+    // Výsledky otáčky → anotace black boxu; kontrola bezpečné zóny kolem robota.
+    void recordRevolution(uint64_t mono_ts_ns, double now, const CorridorSet *c,
+                          const ObjectList *o, const TrackList *tr) {
+        if (!c || !o || !tr) {
+            return;
+        }
+        DistanceQuery q;
+        q.footprint = true;
+        const float d = point_processing_.distance(q, now);
+
+        std::string text = "REV " + std::to_string(rev_seq_) + " dist=" + std::to_string(d) +
+                           "\nCORIDORS " + c->toLine() +
+                           "\nOBJECTS " + o->toLine() +
+                           "\nTRACKS " + tr->toLine();
+        black_box_.annotate(mono_ts_ns, text);
+
+        if (d >= 0.0f && d < kSafetyBreachCm &&
+            (last_breach_ns_ == 0 || mono_ts_ns - last_breach_ns_ > kBreachHoldoffNs)) {
+            last_breach_ns_ = mono_ts_ns;
+            black_box_.trigger("safety dist=" + std::to_string(d));
+        }
+    }
+
+    void resetRevolution() {
+        last_h_angle_ = 0.0f;
+        rev_start_ns_ = 0;
+        tracker_.clear();
+        normal_estimator_.clear();
+        std::lock_guard<std::mutex> lg(result_mtx_);
+        corridors_.reset();
+        objects_.reset();
+        tracks_.reset();
+        grid_snapshot_.reset();
+        height_snapshot_.reset();
+        normals_.reset();
+        clearance_.reset();
+        cloud_.reset();
+    }
+
+    template <typename T>
+    bool getShared(const std::shared_ptr<const T> &src, std::shared_ptr<const T> &out) const {
+        {
+            std::lock_guard<std::mutex> lg(result_mtx_);
+            out = src;
+        }
+        return out && running_.load(std::memory_order_relaxed);
+    }
+
     inline uint64_t getMonotonicTimeNs() {
         using namespace std::chrono;
         return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
     }
 
+    // Raw log podle raw_log_enabled_ a stavu disku (decimation 0 = vypnout).
+    // Logger žije po celou dobu běhu, tady se jen přepíná příznak – otevření
+    // i zavření souboru dělá jeho zapisovač, loopRead na disk nečeká.
+    bool syncRawLogger(bool &raw_on, unsigned decimation) {
+        const bool on = raw_log_enabled_.load(std::memory_order_relaxed) && decimation > 0;
+        if (on != raw_on) {
+            raw_log_.setEnabled(on);
+            raw_on = on;
+        }
+        return on;
+    }
+
     // Čtecí smyčka: parsuje pakety, deleguje na processCloudData/processIMUData.
     void loopRead() {
-        LidarRawLogger raw_logger;
+        bool raw_on = false;
+        unsigned raw_point_count = 0;
         float rev_min = std::numeric_limits<float>::infinity();
         auto t_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(400);
 
@@ -506,24 +942,36 @@ private:
 
             int type = r->runParse();
             uint64_t mono_ts_ns = getMonotonicTimeNs();  
+            const unsigned decimation = storage_.rawDecimation();
+            const bool raw = syncRawLogger(raw_on, decimation);
 
             if (type == LIDAR_POINT_DATA_PACKET_TYPE) {
                 const auto& pkt = r->getLidarPointDataPacket();
-                raw_logger.writePointPacket(pkt, mono_ts_ns);
-                processCloudData(*r, rev_min, t_end);
+                if (raw && raw_point_count++ % decimation == 0) {
+                    raw_log_.writePointPacket(pkt, mono_ts_ns);
+                }
+                point_processing_.setPlyDump(storage_.plyAllowed());
+                black_box_.recordPacket(RawRecordType::Point, pkt, mono_ts_ns);
+                processCloudData(pkt, rev_min, t_end);
+                if (updateRevolution(pkt, mono_ts_ns)) {
+                    onRevolution(mono_ts_ns);
+                }
             } else if (type == LIDAR_IMU_DATA_PACKET_TYPE) {
                 const auto& pkt = r->getLidarImuDataPacket();
-                raw_logger.writeImuPacket(pkt, mono_ts_ns);
+                if (raw) raw_log_.writeImuPacket(pkt, mono_ts_ns);
+                black_box_.recordPacket(RawRecordType::Imu, pkt, mono_ts_ns);
                 processIMUData(*r);
             } else if (type == LIDAR_VERSION_PACKET_TYPE) {
                 const auto& pkt = r->getLidarVersionDataPacket();
-                raw_logger.writeVersionPacket(pkt, mono_ts_ns);
+                if (raw) raw_log_.writeVersionPacket(pkt, mono_ts_ns);
+                black_box_.recordPacket(RawRecordType::Version, pkt, mono_ts_ns);
             } else {
                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
 
             
         }
+        raw_log_.setEnabled(false);   // dopíše rozpracovaný buffer a zavře soubor
     }
 
     // ------------------------------------------------------------------------
@@ -536,6 +984,52 @@ private:
     //PLYLogger proc_logger_;  // transformovaný cloud
 
     LidarPointProcessing point_processing_;
+    CorridorFinder       corridor_finder_;
+    ParallelFor          pool_;                 // sdílený pool pro výpočty za otáčku
+    DistanceTransform    edt_{pool_};
+    ObstacleClustering   clustering_;
+    StageStats           cluster_stats_;
+    ObjectTracker        tracker_;
+    StageStats           tracker_stats_;
+    RawLoggerStats       raw_log_stats_;        // plní raw_log_
+    std::atomic<bool>    raw_log_enabled_{true};
+    LidarRawLogger       raw_log_{"/data/robot/lidar", &raw_log_stats_, true,
+                                  StorageManager::kRawFileBytes, StorageManager::kRawFileNs,
+                                  false};       // zapíná loopRead() (syncRawLogger)
+    BlackBoxRecorder     black_box_{"/data/robot/lidar"};
+    StorageManager       storage_{"/data/robot/lidar"};
+    DistanceQueryCache   query_cache_;
+    NormalEstimator      normal_estimator_{LidarPointProcessing::sensorOrigin()};
+    StageStats           normal_stats_;
+    CloudStreamStats     cloud_stream_;
+
+    // stav otáček (jen vlákno loopRead)
+    float    last_h_angle_{0.0f};
+    uint64_t rev_start_ns_{0};
+    uint64_t rev_seq_{0};
+    uint64_t last_breach_ns_{0};
+
+    static constexpr float    kSafetyBreachCm = 20.0f;               // od obrysu robota
+    static constexpr uint64_t kBreachHoldoffNs = 30000000000ull;
+
+    // výsledky publikované jednou za otáčku (čtou klientská vlákna)
+    mutable std::mutex result_mtx_;
+    std::shared_ptr<const CorridorSet> corridors_;
+    std::shared_ptr<const ObjectList>  objects_;
+    std::shared_ptr<const TrackList>   tracks_;
+    std::shared_ptr<const EgoOccupancyGrid::Snapshot> grid_snapshot_;
+    std::shared_ptr<const DistanceTransform::Result>  clearance_;
+    std::shared_ptr<const HeightMap::Snapshot>        height_snapshot_;
+    std::shared_ptr<const NormalSet>                  normals_;
+    std::shared_ptr<const CloudSnapshot>              cloud_;
+    mutable std::condition_variable                   cloud_cv_;   // s result_mtx_
+
+    ShmPublisher grid_shm_{"/robot_lidar_grid",
+                           sizeof(EgoOccupancyGrid::Meta) + EgoOccupancyGrid::kCells};
+    ShmPublisher height_shm_{"/robot_lidar_heightmap", HeightMap::kExportBytes};
+    ShmPublisher clearance_shm_{"/robot_lidar_clearance",
+                                sizeof(EgoOccupancyGrid::Meta) +
+                                EgoOccupancyGrid::kCells * sizeof(float)};
 
     std::atomic<bool>     running_{false};
     std::atomic<float>    latest_;
@@ -0,0 +1,98 @@
+#pragma once
+
+// negative_obstacles.hpp — negativní překážky (sjezd z obrubníku, příkop, schody dolů)
+// ---------------------------------------------------------------------------
+// • Běží po segmentaci země nad stejnou skenovací linií (sousední sloupce =
+//   sousední vertikální úhly, paprsek "přejíždí" po zemi – podle části linie
+//   od robota nebo k robotu, obě pořadí se berou symetricky).
+// • Bod pod lokální zemí (h < -kDropCm, ale nad -kMaxDepthCm – hlubší je
+//   spíš odraz / chybný model) → label kNegative.
+// • Hrana (lip): zemní bod, po kterém v linii následuje
+//     - bod pod zemí, nebo
+//     - výpadek návratů (aspoň kMinMissing sloupců) a pak bod dál o víc než
+//       očekávaný rozestup paprsků + kGapCm (chybějící země = díra/příkop).
+//   Hrana dostane label kNegative – je to místo, kam robot nesmí dojet.
+// • Jen v pásmu kMinRangeCm..kMaxRangeCm: blíž je tělo robota (výpadky
+//   z ignoreBox), dál jsou výpadky na zemi při malém úhlu dopadu normální.
+// • Výpadek až do konce linie se nebere (nelze odlišit od oblohy).
+// • Body s kNegative jdou do bufferu i do mřížky obsazenosti; dotaz
+//   "DISTANCE neg" vrací nejbližší negativní překážku.
+// ---------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "ground_segmentation.hpp"
+
+class NegativeObstacleDetector
+{
+public:
+    static constexpr float kDropCm      = 15.0f;
+    static constexpr float kMaxDepthCm  = 200.0f;
+    static constexpr float kGapCm       = 30.0f;
+    static constexpr float kGapPerR2    = 0.0003f;   // očekávaný rozestup ~ r² (1/cm)
+    static constexpr int   kMinMissing  = 3;
+    static constexpr float kMinRangeCm  = 60.0f;
+    static constexpr float kMaxRangeCm  = 600.0f;
+
+    // PointT: x, y, valid(), label, height (RangeImage::Cell). Vrací počet
+    // bodů označených kNegative.
+    template <typename PointT>
+    std::size_t scan(PointT *pts, std::size_t n) const
+    {
+        std::size_t marked = 0;
+        int prev = -1;          // poslední platný bod
+        float prev_r = 0.0f;
+        bool prev_ground = false;
+        bool prev_below = false;
+
+        for (std::size_t j = 0; j < n; ++j) {
+            auto &p = pts[j];
+            if (!p.valid()) continue;
+
+            const float r = std::sqrt(p.x * p.x + p.y * p.y);
+            const bool in_band = r >= kMinRangeCm && r <= kMaxRangeCm;
+
+            const float h = p.height;
+            bool below = false;
+            if (in_band && h < -kDropCm && h > -kMaxDepthCm) {
+                p.label = GroundSegmentation::kNegative;
+                below = true;
+                ++marked;
+            }
+
+            const bool ground = in_band && p.label == GroundSegmentation::kGround;
+            if (prev >= 0) {
+                const int missing = static_cast<int>(j) - prev - 1;
+                const float near_r = r < prev_r ? r : prev_r;
+                const bool gap = missing >= kMinMissing &&
+                                 std::fabs(r - prev_r) > kGapCm + kGapPerR2 * near_r * near_r;
+
+                // zemní bod před dírou / pod-zemním bodem (paprsek jde od robota)
+                if (prev_ground && (below || (gap && r > prev_r))) {
+                    marked += mark(pts[prev]);
+                }
+                // zemní bod za dírou (paprsek jde k robotu)
+                if (ground && (prev_below || (gap && r < prev_r))) {
+                    marked += mark(p);
+                }
+            }
+
+            prev = static_cast<int>(j);
+            prev_r = r;
+            prev_ground = ground;
+            prev_below = below;
+        }
+        return marked;
+    }
+
+private:
+    template <typename PointT>
+    static std::size_t mark(PointT &p)
+    {
+        if (p.label == GroundSegmentation::kNegative) return 0;
+        p.label = GroundSegmentation::kNegative;
+        return 1;
+    }
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+// object_tracker.hpp — sledování pohyblivých objektů (chodci, cyklisté)
+// ---------------------------------------------------------------------------
+// • Vstup: ObjectList z ObstacleClustering (jednou za otáčku, rámec robota)
+//   + pose robota v odometrickém rámci ze snapshotu mřížky.
+// • Tracky žijí v odometrickém rámci → stojící objekt má rychlost ~0 i když
+//   robot jede. Stav [x, y, vx, vy], konstantní rychlost, Kalman filtr
+//   zvlášť pro osu x a y (2×2 kovariance na osu, stejný šum v obou osách).
+// • Asociace: greedy nejbližší soused přes páry (track, detekce) v bráně
+//   kGateCm, seřazené podle vzdálenosti predikce od těžiště.
+// • Pevné předalokované tabulky (kMaxTracks tracků, páry kMaxTracks ×
+//   kMaxObjects) → cena omezená i v davu, žádné alokace za běhu.
+// • Životní cyklus: nový track z nepřiřazené detekce, potvrzený po
+//   kConfirmHits zásazích, smazaný po kMaxMisses otáčkách bez detekce.
+// • Výstup (TCP TRACKS): poloha nejbližšího bodu a rychlost v rámci robota,
+//   predikce nejbližšího přiblížení (relativní pohyb vůči robotu, rychlost
+//   robota z rozdílu pose mezi otáčkami) v horizontu kHorizonS.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ego_motion.hpp"
+#include "obstacle_clusters.hpp"
+
+struct TrackedObject
+{
+    std::uint32_t id;
+    std::uint32_t age;         // počet otáček od založení
+    float x, y;                // těžiště, rámec robota [cm]
+    float near_x, near_y;      // nejbližší bod, rámec robota [cm]
+    float vx, vy;              // rychlost vůči zemi v osách robota [cm/s]
+    float speed;               // [cm/s]
+    float t_cpa;               // čas do nejbližšího přiblížení [s]
+    float d_cpa;               // predikovaná nejmenší vzdálenost [cm]
+};
+
+struct TrackList
+{
+    std::uint64_t rev = 0;
+    double        stamp = 0.0;
+    std::vector<TrackedObject> tracks;
+
+    // "<rev> <n> [<id> <age> <x> <y> <nx> <ny> <vx> <vy> <speed> <t_cpa> <d_cpa>]..."
+    std::string toLine() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(1);
+        os << rev << " " << tracks.size();
+        for (const auto &t : tracks) {
+            os << " " << t.id << " " << t.age << " " << t.x << " " << t.y
+               << " " << t.near_x << " " << t.near_y
+               << " " << t.vx << " " << t.vy << " " << t.speed
+               << std::setprecision(2) << " " << t.t_cpa << std::setprecision(1)
+               << " " << t.d_cpa;
+        }
+        return os.str();
+    }
+};
+
+class ObjectTracker
+{
+public:
+    static constexpr int   kMaxTracks   = 64;
+    static constexpr int   kMaxObjects  = ObstacleClustering::kMaxObjects;
+    static constexpr float kGateCm      = 100.0f;   // max. skok těžiště mezi otáčkami
+    static constexpr int   kConfirmHits = 3;
+    static constexpr int   kMaxMisses   = 5;
+    static constexpr float kAccelNoise  = 200.0f;   // σ zrychlení [cm/s²]
+    static constexpr float kMeasNoise   = 10.0f;    // σ těžiště [cm]
+    static constexpr float kInitVelVar  = 200.0f * 200.0f;
+    static constexpr float kHorizonS    = 5.0f;
+    static constexpr double kMaxDt      = 1.0;      // delší mezera → reset
+
+    ObjectTracker()
+    {
+        pairs_.reserve(static_cast<std::size_t>(kMaxTracks) * kMaxObjects);
+        clear();
+    }
+
+    void clear()
+    {
+        for (auto &t : tracks_) t.used = false;
+        last_stamp_ = -1.0;
+    }
+
+    // Jedna otáčka: predikce, asociace, update, výstup potvrzených tracků.
+    void update(const ObjectList &objs, const Pose2D &pose, TrackList &out)
+    {
+        const double dt_d = last_stamp_ < 0.0 ? 0.0 : objs.stamp - last_stamp_;
+        if (dt_d < 0.0 || dt_d > kMaxDt) clear();
+        const float dt = last_stamp_ < 0.0 ? 0.0f : static_cast<float>(dt_d);
+
+        // rychlost robota v odometrickém rámci (pro relativní pohyb)
+        float rvx = 0.0f, rvy = 0.0f;
+        if (last_stamp_ >= 0.0 && dt > 1e-3f) {
+            rvx = (pose.x - last_pose_.x) / dt;
+            rvy = (pose.y - last_pose_.y) / dt;
+        }
+        last_stamp_ = objs.stamp;
+        last_pose_  = pose;
+
+        const float c = std::cos(pose.yaw), s = std::sin(pose.yaw);
+        const int n_obj = std::min<int>(static_cast<int>(objs.objects.size()), kMaxObjects);
+
+        // detekce → odometrický rámec
+        for (int j = 0; j < n_obj; ++j) {
+            const auto &o = objs.objects[j];
+            det_x_[j] = pose.x + c * o.cx - s * o.cy;
+            det_y_[j] = pose.y + s * o.cx + c * o.cy;
+            det_used_[j] = false;
+        }
+
+        // 1) predikce
+        for (auto &t : tracks_) {
+            if (!t.used) continue;
+            predict(t.ax, dt);
+            predict(t.ay, dt);
+            t.matched = false;
+        }
+
+        // 2) asociace: greedy přes páry v bráně
+        pairs_.clear();
+        for (int i = 0; i < kMaxTracks; ++i) {
+            const Track &t = tracks_[i];
+            if (!t.used) continue;
+            for (int j = 0; j < n_obj; ++j) {
+                const float dx = det_x_[j] - t.ax.p, dy = det_y_[j] - t.ay.p;
+                const float d2 = dx * dx + dy * dy;
+                if (d2 <= kGateCm * kGateCm) {
+                    pairs_.push_back(Pair{d2, static_cast<std::int16_t>(i), static_cast<std::int16_t>(j)});
+                }
+            }
+        }
+        std::sort(pairs_.begin(), pairs_.end(),
+                  [](const Pair &a, const Pair &b) { return a.d2 < b.d2; });
+
+        for (const Pair &p : pairs_) {
+            Track &t = tracks_[p.track];
+            if (t.matched || det_used_[p.det]) continue;
+            correct(t.ax, det_x_[p.det]);
+            correct(t.ay, det_y_[p.det]);
+            t.matched = true;
+            t.det = p.det;
+            ++t.hits;
+            t.misses = 0;
+            det_used_[p.det] = true;
+        }
+
+        // 3) nepřiřazené tracky stárnou, nepřiřazené detekce zakládají tracky
+        for (auto &t : tracks_) {
+            if (!t.used) continue;
+            ++t.age;
+            if (!t.matched) {
+                t.det = -1;
+                if (++t.misses > kMaxMisses || t.hits < kConfirmHits) t.used = false;
+            }
+        }
+        for (int j = 0; j < n_obj; ++j) {
+            if (det_used_[j]) continue;
+            Track *slot = nullptr;
+            for (auto &t : tracks_) {
+                if (!t.used) { slot = &t; break; }
+            }
+            if (!slot) break;   // tabulka plná (detekce jsou seřazené, nejbližší už mají track)
+            *slot = Track{};
+            slot->used = true;
+            slot->id = next_id_++;
+            slot->ax = Axis{det_x_[j], 0.0f, kMeasNoise * kMeasNoise, 0.0f, kInitVelVar};
+            slot->ay = Axis{det_y_[j], 0.0f, kMeasNoise * kMeasNoise, 0.0f, kInitVelVar};
+            slot->hits = 1;
+            slot->det = static_cast<std::int16_t>(j);
+        }
+
+        // 4) výstup: potvrzené tracky s detekcí v této otáčce
+        out.rev = objs.rev;
+        out.stamp = objs.stamp;
+        out.tracks.clear();
+        for (const auto &t : tracks_) {
+            if (!t.used || t.hits < kConfirmHits || t.det < 0) continue;
+            const auto &o = objs.objects[t.det];
+
+            TrackedObject r;
+            r.id = t.id;
+            r.age = t.age;
+            r.x = o.cx;
+            r.y = o.cy;
+            r.near_x = o.near_x;
+            r.near_y = o.near_y;
+            // rychlost do os robota
+            r.vx =  c * t.ax.v + s * t.ay.v;
+            r.vy = -s * t.ax.v + c * t.ay.v;
+            r.speed = std::sqrt(t.ax.v * t.ax.v + t.ay.v * t.ay.v);
+
+            // nejbližší přiblížení: relativní pohyb nejbližšího bodu vůči robotu
+            const float wx = t.ax.v - rvx, wy = t.ay.v - rvy;
+            const float ux =  c * wx + s * wy;
+            const float uy = -s * wx + c * wy;
+            const float uu = ux * ux + uy * uy;
+            float tc = uu > 1e-6f ? -(o.near_x * ux + o.near_y * uy) / uu : 0.0f;
+            tc = tc < 0.0f ? 0.0f : (tc > kHorizonS ? kHorizonS : tc);
+            const float px = o.near_x + ux * tc, py = o.near_y + uy * tc;
+            r.t_cpa = tc;
+            r.d_cpa = std::sqrt(px * px + py * py);
+            out.tracks.push_back(r);
+        }
+        std::sort(out.tracks.begin(), out.tracks.end(),
+                  [](const TrackedObject &a, const TrackedObject &b) { return a.d_cpa < b.d_cpa; });
+    }
+
+private:
+    // Kalman CV filtr jedné osy: poloha p, rychlost v, kovariance [pp pv; pv vv].
+    struct Axis {
+        float p, v;
+        float pp, pv, vv;
+    };
+
+    struct Track {
+        bool          used = false;
+        bool          matched = false;
+        std::uint32_t id = 0;
+        std::uint32_t age = 0;
+        int           hits = 0;
+        int           misses = 0;
+        std::int16_t  det = -1;      // index detekce v aktuální otáčce
+        Axis          ax{}, ay{};
+    };
+
+    struct Pair {
+        float        d2;
+        std::int16_t track;
+        std::int16_t det;
+    };
+
+    static void predict(Axis &a, float dt)
+    {
+        if (dt <= 0.0f) return;
+        a.p += a.v * dt;
+        // P = F P Fᵀ + Q (bílý šum zrychlení)
+        const float q  = kAccelNoise * kAccelNoise;
+        const float dt2 = dt * dt;
+        a.pp += dt * (2.0f * a.pv + dt * a.vv) + q * dt2 * dt2 * 0.25f;
+        a.pv += dt * a.vv + q * dt2 * dt * 0.5f;
+        a.vv += q * dt2;
+    }
+
+    static void correct(Axis &a, float z)
+    {
+        const float r = kMeasNoise * kMeasNoise;
+        const float S = a.pp + r;
+        const float kp = a.pp / S, kv = a.pv / S;
+        const float y = z - a.p;
+        a.p += kp * y;
+        a.v += kv * y;
+        const float pp = a.pp, pv = a.pv;
+        a.pp = (1.0f - kp) * pp;
+        a.pv = (1.0f - kp) * pv;
+        a.vv -= kv * pv;
+    }
+
+    std::array<Track, kMaxTracks>   tracks_{};
+    std::array<float, kMaxObjects>  det_x_{}, det_y_{};
+    std::array<bool,  kMaxObjects>  det_used_{};
+    std::vector<Pair>               pairs_;     // kapacita kMaxTracks × kMaxObjects
+    std::uint32_t next_id_{1};
+    double        last_stamp_{-1.0};
+    Pose2D        last_pose_{};
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+// obstacle_clusters.hpp — shlukování překážek nad mřížkou obsazenosti
+// ---------------------------------------------------------------------------
+// • Connected components (8-sousedství) nad snapshotem EgoOccupancyGrid
+//   (buňka obsazená, pokud hits >= kOccupiedHits). BFS s předalokovanou
+//   frontou, žádné alokace během výpočtu.
+// • Body bufferu (jen label překážka, převedené do aktuálního rámce robota)
+//   se přes buňku přiřadí ke shluku → těžiště, 2D bounding box, rozsah výšky
+//   nad zemí, počet bodů, nejbližší bod.
+// • Výstup jednou za otáčku: ObjectList (TCP OBJECTS). Shluky s méně než
+//   kMinPoints body se zahodí, max. kMaxObjects (nejbližší mají přednost).
+// • Souřadnice v cm v rámci robota (x vpřed, y vlevo).
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "occupancy_grid.hpp"
+#include "point_processing.hpp"
+
+struct ObstacleObject
+{
+    std::uint32_t id;          // index v rámci otáčky
+    float cx, cy;              // těžiště bodů
+    float x_min, y_min;        // bounding box
+    float x_max, y_max;
+    float h_min, h_max;        // výška nad zemí
+    std::uint32_t points;
+    float near_x, near_y;      // nejbližší bod
+    float near_d;              // jeho vzdálenost
+};
+
+struct ObjectList
+{
+    std::uint64_t rev = 0;
+    double        stamp = 0.0;
+    std::vector<ObstacleObject> objects;
+
+    // "<rev> <n> [<id> <cx> <cy> <xmin> <ymin> <xmax> <ymax> <hmin> <hmax> <points> <nx> <ny> <nd>]..."
+    std::string toLine() const
+    {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(1);
+        os << rev << " " << objects.size();
+        for (const auto &o : objects) {
+            os << " " << o.id << " " << o.cx << " " << o.cy
+               << " " << o.x_min << " " << o.y_min << " " << o.x_max << " " << o.y_max
+               << " " << o.h_min << " " << o.h_max << " " << o.points
+               << " " << o.near_x << " " << o.near_y << " " << o.near_d;
+        }
+        return os.str();
+    }
+};
+
+class ObstacleClustering
+{
+public:
+    static constexpr int kSize       = EgoOccupancyGrid::kSize;
+    static constexpr int kCells      = EgoOccupancyGrid::kCells;
+    static constexpr int kMaxObjects = 128;
+    static constexpr std::uint32_t kMinPoints = 5;
+
+    ObstacleClustering()
+        : labels_(kCells), queue_(kCells)
+    {
+        acc_.reserve(kCells / 4);
+    }
+
+    void compute(const EgoOccupancyGrid::Snapshot &grid,
+                 const LidarPointProcessing::Sample *samples,
+                 std::size_t n,
+                 EgoCompensator &comp,
+                 std::uint64_t rev,
+                 double stamp,
+                 ObjectList &out)
+    {
+        const int n_clusters = label(grid);
+        accumulate(grid, samples, n, comp, n_clusters);
+
+        out.rev = rev;
+        out.stamp = stamp;
+        out.objects.clear();
+        for (int k = 0; k < n_clusters; ++k) {
+            const Acc &a = acc_[k];
+            if (a.points < kMinPoints) continue;
+
+            ObstacleObject o;
+            o.cx = static_cast<float>(a.sx / a.points);
+            o.cy = static_cast<float>(a.sy / a.points);
+            o.x_min = a.x_min; o.y_min = a.y_min;
+            o.x_max = a.x_max; o.y_max = a.y_max;
+            o.h_min = a.h_min; o.h_max = a.h_max;
+            o.points = a.points;
+            o.near_x = a.near_x; o.near_y = a.near_y;
+            o.near_d = std::sqrt(a.near_d2);
+            out.objects.push_back(o);
+        }
+
+        std::sort(out.objects.begin(), out.objects.end(),
+                  [](const ObstacleObject &a, const ObstacleObject &b) { return a.near_d < b.near_d; });
+        if (out.objects.size() > static_cast<std::size_t>(kMaxObjects)) {
+            out.objects.resize(kMaxObjects);
+        }
+        for (std::size_t i = 0; i < out.objects.size(); ++i) {
+            out.objects[i].id = static_cast<std::uint32_t>(i);
+        }
+    }
+
+private:
+    struct Acc {
+        double sx, sy;
+        float  x_min, y_min, x_max, y_max;
+        float  h_min, h_max;
+        float  near_x, near_y, near_d2;
+        std::uint32_t points;
+    };
+
+    // 8-sousedské komponenty; labels_[i] = index shluku nebo -1.
+    int label(const EgoOccupancyGrid::Snapshot &grid)
+    {
+        std::fill(labels_.begin(), labels_.end(), -1);
+        int next = 0;
+
+        for (int start = 0; start < kCells; ++start) {
+            if (labels_[start] >= 0 || grid.hits[start] < EgoOccupancyGrid::kOccupiedHits) {
+                continue;
+            }
+
+            int qh = 0, qt = 0;
+            queue_[qt++] = start;
+            labels_[start] = next;
+            while (qh < qt) {
+                const int i = queue_[qh++];
+                const int r = i / kSize, c = i % kSize;
+                for (int dr = -1; dr <= 1; ++dr) {
+                    const int rr = r + dr;
+                    if (rr < 0 || rr >= kSize) continue;
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        const int cc = c + dc;
+                        if (cc < 0 || cc >= kSize) continue;
+                        const int j = rr * kSize + cc;
+                        if (labels_[j] < 0 && grid.hits[j] >= EgoOccupancyGrid::kOccupiedHits) {
+                            labels_[j] = next;
+                            queue_[qt++] = j;
+                        }
+                    }
+                }
+            }
+            ++next;
+        }
+        return next;
+    }
+
+    void accumulate(const EgoOccupancyGrid::Snapshot &grid,
+                    const LidarPointProcessing::Sample *samples,
+                    std::size_t n,
+                    EgoCompensator &comp,
+                    int n_clusters)
+    {
+        constexpr float kInf = std::numeric_limits<float>::max();
+        acc_.assign(static_cast<std::size_t>(n_clusters),
+                    Acc{0.0, 0.0, kInf, kInf, -kInf, -kInf, kInf, -kInf, 0.0f, 0.0f, kInf, 0});
+
+        const auto &m = grid.meta;
+        const float c = std::cos(m.pose_yaw), s = std::sin(m.pose_yaw);
+
+        for (std::size_t i = 0; i < n; ++i) {
+            const auto &p = samples[i];
+            if (p.label != GroundSegmentation::kObstacle) continue;
+
+            float x, y;
+            if (!comp.apply(p.batch, p.x, p.y, x, y)) continue;
+
+            // aktuální rámec robota → buňka snapshotu (odometrický rámec)
+            const float wx = m.pose_x_cm + c * x - s * y;
+            const float wy = m.pose_y_cm + s * x + c * y;
+            const int cx = static_cast<int>(std::floor(wx / m.cell_cm)) - m.origin_cx;
+            const int cy = static_cast<int>(std::floor(wy / m.cell_cm)) - m.origin_cy;
+            if (cx < 0 || cy < 0 || cx >= kSize || cy >= kSize) continue;
+
+            const int k = labels_[cy * kSize + cx];
+            if (k < 0) continue;
+
+            Acc &a = acc_[k];
+            a.sx += x; a.sy += y;
+            a.x_min = std::min(a.x_min, x); a.x_max = std::max(a.x_max, x);
+            a.y_min = std::min(a.y_min, y); a.y_max = std::max(a.y_max, y);
+            a.h_min = std::min(a.h_min, p.height); a.h_max = std::max(a.h_max, p.height);
+            const float d2 = x * x + y * y;
+            if (d2 < a.near_d2) { a.near_d2 = d2; a.near_x = x; a.near_y = y; }
+            ++a.points;
+        }
+    }
+
+    std::vector<int> labels_;
+    std::vector<int> queue_;
+    std::vector<Acc> acc_;
+};
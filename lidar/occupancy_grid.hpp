@@ -0,0 +1,224 @@
+#pragma once
+
+// occupancy_grid.hpp — robot-centrická rolovací 2D mřížka obsazenosti
+// ---------------------------------------------------------------------------
+// • kSize × kSize buněk po kCellCm (default 200 × 200 × 5 cm = 10 × 10 m).
+// • Mřížka je zarovnaná s odometrickým rámcem (pose robota přes setPose()),
+//   střed = buňka robota. Dokud pose nikdo nenastavuje, je odometrie = rámec
+//   robota a mřížka se neroluje.
+// • Úložiště je toroidní (index = globální buňka mod kSize) → rolování při
+//   pohybu robota jen vynuluje řádky/sloupce, které do okna nově vstoupily,
+//   nic se nekopíruje.
+// • Každá buňka: hits (uint8, saturace 255) + stamp (uint16, tiky 10 ms).
+//   decay() jednou za otáčku: buňky bez nového zásahu déle než kDecayTicks
+//   ztrácí polovinu zásahů.
+// • Export: snapshot() rozbalí toroid do lineárního pole (řádek = y, sloupec = x,
+//   buňka [0,0] = levý dolní roh okna) – pro shared memory i TCP.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class EgoOccupancyGrid
+{
+public:
+    static constexpr int   kSize       = 200;
+    static constexpr float kCellCm     = 5.0f;
+    static constexpr int   kCells      = kSize * kSize;
+    static constexpr std::uint16_t kDecayTicks = 50;   // 0.5 s
+    static constexpr std::uint8_t  kOccupiedHits = 2;  // práh pro bitset export
+
+    // Metadata snapshotu (sdílená s shm exportem, proto POD).
+    struct Meta {
+        std::uint32_t size;        // kSize
+        float         cell_cm;     // kCellCm
+        std::int32_t  origin_cx;   // globální index buňky [0,0] snapshotu
+        std::int32_t  origin_cy;
+        float         pose_x_cm;   // pose robota v odometrickém rámci
+        float         pose_y_cm;
+        float         pose_yaw;    // [rad]
+        std::uint32_t rev;         // otáčka, ze které je snapshot
+    };
+
+    struct Snapshot {
+        Meta meta{};
+        std::vector<std::uint8_t> hits;   // kCells, řádek po řádku
+    };
+
+    EgoOccupancyGrid() { clear(); }
+
+    void clear()
+    {
+        hits_.fill(0);
+        stamp_.fill(0);
+        pose_x_ = pose_y_ = pose_yaw_ = 0.0f;
+        cos_yaw_ = 1.0f; sin_yaw_ = 0.0f;
+        center_cx_ = center_cy_ = 0;
+    }
+
+    static std::uint16_t ticks(double stamp_s)
+    {
+        return static_cast<std::uint16_t>(
+            static_cast<std::uint64_t>(stamp_s * 100.0) & 0xFFFFu);
+    }
+
+    // Nastaví pose robota v odometrickém rámci [cm, rad] a odroluje okno.
+    void setPose(float x_cm, float y_cm, float yaw)
+    {
+        pose_x_ = x_cm; pose_y_ = y_cm; pose_yaw_ = yaw;
+        cos_yaw_ = std::cos(yaw);
+        sin_yaw_ = std::sin(yaw);
+
+        const int cx = cellOf(x_cm);
+        const int cy = cellOf(y_cm);
+        scrollTo(cx, cy);
+    }
+
+    // Zápis bodu v rámci robota [cm].
+    inline void insert(float x_cm, float y_cm, std::uint16_t now)
+    {
+        const float wx = pose_x_ + cos_yaw_ * x_cm - sin_yaw_ * y_cm;
+        const float wy = pose_y_ + sin_yaw_ * x_cm + cos_yaw_ * y_cm;
+        const int gx = cellOf(wx);
+        const int gy = cellOf(wy);
+        if (!inWindow(gx, gy)) return;
+
+        const int i = index(gx, gy);
+        if (hits_[i] < 255) ++hits_[i];
+        stamp_[i] = now;
+    }
+
+    // Polovina zásahů pryč pro buňky, které se kDecayTicks neobnovily.
+    void decay(std::uint16_t now)
+    {
+        for (int i = 0; i < kCells; ++i) {
+            const std::uint16_t age = static_cast<std::uint16_t>(now - stamp_[i]);
+            const bool old = age > kDecayTicks;
+            hits_[i] = old ? static_cast<std::uint8_t>(hits_[i] >> 1) : hits_[i];
+            stamp_[i] = old ? now : stamp_[i];
+        }
+    }
+
+    // Obsazenost buňky v rámci robota [cm]; -1 mimo okno.
+    int hitsAt(float x_cm, float y_cm) const
+    {
+        const float wx = pose_x_ + cos_yaw_ * x_cm - sin_yaw_ * y_cm;
+        const float wy = pose_y_ + sin_yaw_ * x_cm + cos_yaw_ * y_cm;
+        const int gx = cellOf(wx);
+        const int gy = cellOf(wy);
+        if (!inWindow(gx, gy)) return -1;
+        return hits_[index(gx, gy)];
+    }
+
+    void snapshot(Snapshot &out, std::uint32_t rev) const
+    {
+        out.meta.size      = kSize;
+        out.meta.cell_cm   = kCellCm;
+        out.meta.origin_cx = center_cx_ - kSize / 2;
+        out.meta.origin_cy = center_cy_ - kSize / 2;
+        out.meta.pose_x_cm = pose_x_;
+        out.meta.pose_y_cm = pose_y_;
+        out.meta.pose_yaw  = pose_yaw_;
+        out.meta.rev       = rev;
+        out.hits.resize(kCells);
+        unroll(out.hits.data(), out.meta.origin_cx, out.meta.origin_cy);
+    }
+
+    // Rozbalení toroidu do lineárního pole (kCells bajtů).
+    void unroll(std::uint8_t *dst, int origin_cx, int origin_cy) const
+    {
+        const int ox = mod(origin_cx);
+        const int first = kSize - ox;   // délka první části řádku
+        for (int r = 0; r < kSize; ++r) {
+            const std::uint8_t *row = &hits_[mod(origin_cy + r) * kSize];
+            std::uint8_t *d = dst + r * kSize;
+            std::memcpy(d, row + ox, first);
+            std::memcpy(d + first, row, ox);
+        }
+    }
+
+    // Snapshot → bitset (bit = hits >= kOccupiedHits), LSB first, řádek po řádku.
+    static std::vector<std::uint8_t> toBitset(const Snapshot &s)
+    {
+        std::vector<std::uint8_t> bits((s.hits.size() + 7) / 8, 0);
+        for (std::size_t i = 0; i < s.hits.size(); ++i) {
+            if (s.hits[i] >= kOccupiedHits) {
+                bits[i >> 3] |= static_cast<std::uint8_t>(1u << (i & 7));
+            }
+        }
+        return bits;
+    }
+
+private:
+    static inline int cellOf(float cm)
+    {
+        return static_cast<int>(std::floor(cm / kCellCm));
+    }
+
+    static inline int mod(int v)
+    {
+        const int m = v % kSize;
+        return m < 0 ? m + kSize : m;
+    }
+
+    inline bool inWindow(int gx, int gy) const
+    {
+        return gx >= center_cx_ - kSize / 2 && gx < center_cx_ + kSize / 2 &&
+               gy >= center_cy_ - kSize / 2 && gy < center_cy_ + kSize / 2;
+    }
+
+    static inline int index(int gx, int gy) { return mod(gy) * kSize + mod(gx); }
+
+    void clearColumn(int gx)
+    {
+        const int c = mod(gx);
+        for (int r = 0; r < kSize; ++r) {
+            hits_[r * kSize + c] = 0;
+            stamp_[r * kSize + c] = 0;
+        }
+    }
+
+    void clearRow(int gy)
+    {
+        const int r = mod(gy);
+        std::memset(&hits_[r * kSize], 0, kSize);
+        std::fill_n(&stamp_[r * kSize], kSize, std::uint16_t{0});
+    }
+
+    // Posun okna: vynuluj jen buňky, které do okna nově vstupují.
+    void scrollTo(int cx, int cy)
+    {
+        const int dx = cx - center_cx_;
+        const int dy = cy - center_cy_;
+        if (dx == 0 && dy == 0) return;
+
+        if (std::abs(dx) >= kSize || std::abs(dy) >= kSize) {
+            hits_.fill(0);
+            stamp_.fill(0);
+        } else {
+            // nové sloupce: [old_max, new_max) resp. [new_min, old_min)
+            for (int k = 0; k < std::abs(dx); ++k) {
+                clearColumn(dx > 0 ? center_cx_ + kSize / 2 + k
+                                   : center_cx_ - kSize / 2 - 1 - k);
+            }
+            for (int k = 0; k < std::abs(dy); ++k) {
+                clearRow(dy > 0 ? center_cy_ + kSize / 2 + k
+                                : center_cy_ - kSize / 2 - 1 - k);
+            }
+        }
+        center_cx_ = cx;
+        center_cy_ = cy;
+    }
+
+    alignas(64) std::array<std::uint8_t,  kCells> hits_{};
+    alignas(64) std::array<std::uint16_t, kCells> stamp_{};
+
+    float pose_x_{0.0f}, pose_y_{0.0f}, pose_yaw_{0.0f};
+    float cos_yaw_{1.0f}, sin_yaw_{0.0f};
+    int   center_cx_{0}, center_cy_{0};
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+// outlier_filter.hpp — odfiltrování osamocených bodů (prach, tráva, déšť)
+// ---------------------------------------------------------------------------
+// • Běží nad právě dekódovanou linií range image, PŘED segmentací země
+//   → odmítnutý bod (range_mm = 0) se nedostane do bufferu, mřížky ani
+//   distance().
+// • Podpora bodu = počet sousedů s podobnou vzdáleností
+//   (|Δ| <= max(kAbsTolMm, range / kRelTolDiv)):
+//     - stejná linie, sloupce c±1, c±2 (sousední vertikální úhly)
+//     - předchozí linie (předchozí paket), sloupce c-1..c+1
+//     - stejný řádek range image z minulé otáčky (perzistence), c-1..c+1,
+//       jen pokud není starší než kPersistTtl
+//   Bod s podporou < kMinSupport (u slabého odrazu intensity < kLowIntensity
+//   o jedna víc) je odmítnut.
+// • Filtruje se jen do kMaxRangeMm – dál jsou body řídké přirozeně a falešné
+//   zastavení nezpůsobí.
+// • Historie drží syrové vzdálenosti (před filtrací) → skutečný objekt
+//   si podporu z minulé otáčky udrží.
+// • Statistika (TCP STATS): zkontrolované / odmítnuté body, z toho slabé.
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "range_image.hpp"
+
+class OutlierFilter
+{
+public:
+    static constexpr int           kRows        = RangeImage::kRows;
+    static constexpr int           kCols        = RangeImage::kCols;
+    static constexpr std::uint16_t kMaxRangeMm  = 5000;
+    static constexpr std::uint16_t kAbsTolMm    = 100;
+    static constexpr int           kRelTolDiv   = 8;      // tolerance = range / 8
+    static constexpr int           kMinSupport  = 2;
+    static constexpr std::uint8_t  kLowIntensity = 10;
+    static constexpr double        kPersistTtl  = 0.5;    // [s]
+    static constexpr double        kLineGap     = 0.05;   // [s] max. mezera k předchozí linii
+
+    struct Counters {
+        std::atomic<std::uint64_t> checked{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::atomic<std::uint64_t> rejected_weak{0};   // z toho slabý odraz
+    };
+
+    OutlierFilter()
+        : hist_(static_cast<std::size_t>(kRows) * kCols, 0), hist_stamp_(kRows, -1.0)
+    {
+        last_.fill(0);
+    }
+
+    void clear()
+    {
+        std::fill(hist_.begin(), hist_.end(), 0);
+        std::fill(hist_stamp_.begin(), hist_stamp_.end(), -1.0);
+        last_.fill(0);
+        last_stamp_ = -1.0;
+    }
+
+    // Filtrace linie v řádku r range image (buňky cells[0..n)). Vrací počet odmítnutých.
+    std::size_t filter(RangeImage::Cell *cells, std::size_t n, int r, double stamp)
+    {
+        // syrové vzdálenosti linie (filtrace píše do cells, sousedé musí vidět originál)
+        std::array<std::uint16_t, kCols + 4> cur{};
+        for (std::size_t j = 0; j < n; ++j) cur[j + 2] = cells[j].range_mm;
+
+        std::uint16_t *hist = &hist_[static_cast<std::size_t>(r) * kCols];
+        const bool use_hist = hist_stamp_[r] >= stamp - kPersistTtl;
+        const bool use_last = last_stamp_ >= stamp - kLineGap;
+
+        std::size_t checked = 0, rejected = 0, weak = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            const int rng = cur[j + 2];
+            if (rng == 0 || rng > kMaxRangeMm) continue;
+            ++checked;
+
+            const int tol = rng / kRelTolDiv > kAbsTolMm ? rng / kRelTolDiv : kAbsTolMm;
+            auto near = [rng, tol](int o) { return o != 0 && (o - rng <= tol) && (rng - o <= tol); };
+
+            int support = near(cur[j]) + near(cur[j + 1]) + near(cur[j + 3]) + near(cur[j + 4]);
+            const int lo = j > 0 ? static_cast<int>(j) - 1 : 0;
+            const int hi = j + 1 < n ? static_cast<int>(j) + 1 : static_cast<int>(j);
+            if (use_last) {
+                for (int k = lo; k <= hi; ++k) support += near(last_[k]);
+            }
+            if (use_hist) {
+                for (int k = lo; k <= hi; ++k) support += near(hist[k]);
+            }
+
+            const bool is_weak = cells[j].intensity < kLowIntensity;
+            if (support < kMinSupport + (is_weak ? 1 : 0)) {
+                cells[j].range_mm = 0;
+                ++rejected;
+                weak += is_weak;
+            }
+        }
+
+        // historie: syrové vzdálenosti této linie
+        for (std::size_t j = 0; j < n; ++j) {
+            hist[j] = cur[j + 2];
+            last_[j] = cur[j + 2];
+        }
+        for (std::size_t j = n; j < static_cast<std::size_t>(kCols); ++j) {
+            hist[j] = 0;
+            last_[j] = 0;
+        }
+        hist_stamp_[r] = stamp;
+        last_stamp_ = stamp;
+
+        counters_.checked.store(counters_.checked.load(std::memory_order_relaxed) + checked,
+                                std::memory_order_relaxed);
+        counters_.rejected.store(counters_.rejected.load(std::memory_order_relaxed) + rejected,
+                                 std::memory_order_relaxed);
+        counters_.rejected_weak.store(counters_.rejected_weak.load(std::memory_order_relaxed) + weak,
+                                      std::memory_order_relaxed);
+        return rejected;
+    }
+
+    // "outliers checked=.. rejected=.. weak=.. rate=.."
+    std::string toString(const char *name) const
+    {
+        const std::uint64_t c = counters_.checked.load(std::memory_order_relaxed);
+        const std::uint64_t r = counters_.rejected.load(std::memory_order_relaxed);
+        std::ostringstream os;
+        os << name
+           << " checked=" << c
+           << " rejected=" << r
+           << " weak=" << counters_.rejected_weak.load(std::memory_order_relaxed)
+           << " rate=" << (c ? static_cast<double>(r) / c : 0.0);
+        return os.str();
+    }
+
+private:
+    std::vector<std::uint16_t>       hist_;         // kRows × kCols, minulá otáčka
+    std::vector<double>              hist_stamp_;   // čas řádku v historii
+    std::array<std::uint16_t, kCols> last_;         // předchozí linie
+    double                           last_stamp_{-1.0};
+    Counters                         counters_;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+// parallel_for.hpp — malý pevný pool vláken pro výpočty "jednou za otáčku"
+// ---------------------------------------------------------------------------
+// • run(n, fn) rozdělí [0, n) na souvislé bloky, jeden na vlákno, a počká,
+//   až všechny doběhnou. Volající vlákno počítá blok 0 (worker = 0).
+// • fn(begin, end, worker): worker ∈ [0, threads()) – index pro per-thread
+//   pracovní paměť, takže uvnitř se nic nealokuje.
+// • Vlákna vznikají jednou v konstruktoru; run() nevolat souběžně.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ParallelFor
+{
+public:
+    // threads = 0 → všechna jádra (Jetson Orin: 6–12)
+    explicit ParallelFor(unsigned threads = 0)
+    {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads_ = threads;
+        for (unsigned i = 1; i < threads_; ++i) {
+            workers_.emplace_back(&ParallelFor::loop, this, i);
+        }
+    }
+
+    ~ParallelFor()
+    {
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            quit_ = true;
+        }
+        cv_start_.notify_all();
+        for (auto &t : workers_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    ParallelFor(const ParallelFor &) = delete;
+    ParallelFor &operator=(const ParallelFor &) = delete;
+
+    unsigned threads() const { return threads_; }
+
+    void run(int n, const std::function<void(int, int, int)> &fn)
+    {
+        if (threads_ == 1 || n < static_cast<int>(threads_)) {
+            fn(0, n, 0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            fn_ = &fn;
+            n_ = n;
+            pending_ = threads_ - 1;
+            ++generation_;
+        }
+        cv_start_.notify_all();
+
+        const auto r = range(0);
+        fn(r.first, r.second, 0);
+
+        std::unique_lock<std::mutex> lk(mtx_);
+        cv_done_.wait(lk, [this] { return pending_ == 0; });
+        fn_ = nullptr;
+    }
+
+private:
+    std::pair<int, int> range(unsigned worker) const
+    {
+        const int chunk = (n_ + static_cast<int>(threads_) - 1) / static_cast<int>(threads_);
+        const int b = std::min(n_, static_cast<int>(worker) * chunk);
+        const int e = std::min(n_, b + chunk);
+        return {b, e};
+    }
+
+    void loop(unsigned worker)
+    {
+        unsigned long seen = 0;
+        for (;;) {
+            const std::function<void(int, int, int)> *fn = nullptr;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_start_.wait(lk, [&] { return quit_ || generation_ != seen; });
+                if (quit_) return;
+                seen = generation_;
+                fn = fn_;
+            }
+
+            const auto r = range(worker);
+            if (r.first < r.second) {
+                (*fn)(r.first, r.second, static_cast<int>(worker));
+            }
+
+            {
+                std::lock_guard<std::mutex> lg(mtx_);
+                if (--pending_ == 0) cv_done_.notify_one();
+            }
+        }
+    }
+
+    unsigned threads_{1};
+    std::vector<std::thread> workers_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_start_;
+    std::condition_variable cv_done_;
+    const std::function<void(int, int, int)> *fn_{nullptr};
+    int n_{0};
+    unsigned pending_{0};
+    unsigned long generation_{0};
+    bool quit_{false};
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <cmath>
 #include <limits>
@@ -15,6 +17,18 @@
 #include <Eigen/Dense>
 #include "unitree_lidar_utilities.h"   // PointCloudUnitree, PointUnitree :contentReference[oaicite:1]{index=1}
 
+#include "range_image.hpp"
+#include "imu_deskew.hpp"
+#include "ego_motion.hpp"
+#include "occupancy_grid.hpp"
+#include "ground_segmentation.hpp"
+#include "outlier_filter.hpp"
+#include "negative_obstacles.hpp"
+#include "height_map.hpp"
+#include "distance_histogram.hpp"
+#include "distance_query.hpp"
+#include "stage_stats.hpp"
+
 class LidarPointProcessing
 {
 public:
@@ -23,72 +37,212 @@ public:
         float y;
         float z;
         float intensity;
-        double ftime;          // absolutní čas [s] (cloud.stamp + point.time)
-        double rtime;
-        std::uint32_t ring;
+        double ftime;          // absolutní čas [s] začátku linie
+        double rtime;          // čas bodu relativně k ftime [s]
+        std::uint32_t ring;    // sloupec range image (vertikální úhel)
+        float height;          // výška nad lokální zemí [cm] (GroundSegmentation)
+        std::uint8_t label;    // GroundSegmentation::Label
+        std::uint32_t batch;   // BatchPoses seq (pose robota v čase záznamu)
     };
 
     static constexpr std::size_t kCapacity = 1u << 16; // 65536 bodů
 
-    LidarPointProcessing() = default;
+    // Záložní z-pásmo překážek [cm] – pro sektory bez fitu země
+    // a pro distance(z_min, z_max).
+    static constexpr float kObstacleZMin = -50.0f;
+    static constexpr float kObstacleZMax =  80.0f;
+
+    // Obdélník robota [cm, rámec robota] – ořez vlastních bodů a footprint dotazů.
+    static constexpr float kBodyXMin = -50.0f;
+    static constexpr float kBodyXMax =  20.0f;
+    static constexpr float kBodyYMin = -20.0f;
+    static constexpr float kBodyYMax =  20.0f;
+
+    static constexpr float kMaxDistanceCm = 5000.0f;
 
-    // Aktualizace z nového cloud-u (v lidar frame, v metrech).
-    void updateCloud(const unilidar_sdk2::PointCloudUnitree &cloud_in)
+    LidarPointProcessing()
     {
-        // 1) Transformace do rámce robota + odfiltrování kvádru robota.
-        unilidar_sdk2::PointCloudUnitree cloud_robot = transformCloud(cloud_in);
+        // svislá osa robota v rámci LiDARu = 3. řádek rotační části transformMatrix()
+        const Eigen::Matrix4f &T = transformMatrix();
+        imu_.setYawAxis(Eigen::Vector3f(T(2,0), T(2,1), T(2,2)));
+    }
 
-        const double base_stamp = cloud_robot.stamp;  // absolutní čas začátku scanu
+    // PLY dump při přetečení bufferu zap/vyp (StorageManager, jen vlákno loopRead).
+    void setPlyDump(bool on) { ply_dump_ = on; }
 
-        // 2) Zápis bodů do ring bufferu.
-        for (const auto &pt : cloud_robot.points) {
-            Sample s;
-            s.x = pt.x;           // už ve tvém měřítku (cm) díky Ms=100 v transformMatrix
-            s.y = pt.y;
-            s.z = pt.z;
-            s.intensity = pt.intensity;
-            s.ftime = base_stamp; 
-            s.rtime = static_cast<double>(pt.time); // point.time je relativní od cloud.stamp :contentReference[oaicite:2]{index=2}
-            s.ring = pt.ring;
+    // Nový vzorek odometrie (kola / fusion) v odometrickém rámci [cm, rad].
+    // Volá se z klientských vláken (příkaz ODOM).
+    void updateOdom(double stamp, const Pose2D &pose)
+    {
+        odom_.push(stamp, pose);
+    }
 
-            pushSample(s);
-        }
+    // Nový IMU vzorek (gyro) → historie orientací pro deskew.
+    // stamp = systémový čas přijetí [s] (stejná časová osa jako linie).
+    void updateImu(const unilidar_sdk2::LidarImuData &imu, double stamp)
+    {
+        imu_.push(stamp, imu.angular_velocity);
     }
 
-    // Minimální vzdálenost překážky v rozsahu z∈[z_min,z_max] (v cm v rámci robota).
-    // Vrací:
-    //   - sqrt(x^2 + y^2) [cm]
-    //   - 5000cm pokud v bufferu není žádný bod v z-intervalu.
-    float distance(float z_min = -50.0f, float z_max = 80.0f) const
+    // Aktualizace z nového paketu (jedna skenovací linie).
+    // Paket se dekóduje rovnou do řádku range image (deskew podle gyra do času
+    // posledního IMU vzorku, transformace do rámce robota + odfiltrování
+    // kvádru robota), odfiltrují se osamocené body (prach, tráva, déšť),
+    // linie se segmentuje a platné
+    // buňky jdou do ring bufferu a mřížky obsazenosti.
+    // Body v bufferu zůstávají v rámci robota v čase t_ref; paket dostane
+    // batch s pose robota v t_ref, dotazy je převádí do aktuálního rámce.
+    // stamp = absolutní čas začátku linie [s], rev = pořadí otáčky.
+    void updatePacket(const unilidar_sdk2::LidarPointDataPacket &pkt,
+                      double stamp,
+                      std::uint32_t rev)
     {
-        if (size_ < kCapacity) {
-            return -1.0f;
+        // 1) Deskew: každý bod linie natočit do referenčního času (nejnovější IMU).
+        LineDeskew deskew;
+        std::uint32_t batch;
+        {
+            StageTimer t(deskew_stats_, 1);
+            const double span = static_cast<double>(pkt.data.time_increment) *
+                                (pkt.data.point_num > 0 ? pkt.data.point_num - 1 : 0);
+            const double t_ref = std::max(imu_.latestStamp(), stamp + span);
+            deskew = imu_.deskewFor(stamp, span, t_ref);
+
+            // pose robota v t_ref → batch + posun mřížky obsazenosti
+            const Pose2D pose = pose_.poseAt(t_ref);
+            batch = batches_.begin(pose);
+            grid_.setPose(pose.x, pose.y, pose.yaw);
+            height_.setPose(pose.x, pose.y, pose.yaw);
         }
 
-        //const std::size_t N = (size_ < kCapacity) ? size_ : kCapacity;
+        // 2) Dekódování + transformace přímo do range image.
+        const int r = range_image_.decode(pkt, stamp, rev, transformMatrix(), ignoreBox, deskew);
+        RangeImage::Cell *cells = range_image_.rowData(r);
+        const std::size_t n = range_image_.row(r).n;
 
-        float min_sq = 5000.0; // 5000 cm = 50m
-        bool found = false;
+        const std::uint16_t grid_now = EgoOccupancyGrid::ticks(stamp);
 
-        for (std::size_t i = 0; i < kCapacity; ++i) {
-            const Sample &p = buffer_[i];
+        // 3) Osamocené body pryč dřív, než ovlivní zemi, buffer a mřížku.
+        {
+            StageTimer t(outlier_stats_, n);
+            outliers_.filter(cells, n, r, stamp);
+        }
+
+        // 4) Segmentace země → label + výška nad zemí pro každý bod linie.
+        {
+            StageTimer t(ground_stats_, n);
+            ground_.segment(cells, n, stamp, kObstacleZMin, kObstacleZMax);
+        }
+
+        // 5) Negativní překážky (hrany, body pod zemí) nad toutéž linií.
+        {
+            StageTimer t(negative_stats_, n);
+            negative_.scan(cells, n);
+        }
+
+        // 6) Výšková mapa – celá linie najednou (sloučené úseky po buňkách).
+        {
+            StageTimer t(height_stats_, n);
+            height_.insertLine(cells, n, grid_now);
+        }
 
-            if (p.z < z_min || p.z > z_max) {
+        // 7) Zápis platných bodů do ring bufferu.
+        for (std::size_t j = 0; j < n; ++j) {
+            const RangeImage::Cell &c = cells[j];
+            if (!c.valid()) {
                 continue;
             }
 
-            const float d2 = p.x * p.x + p.y * p.y;
-            if (d2 < min_sq) {
-                min_sq = d2;
-                found = true;
+            Sample s;
+            s.x = c.x;            // už ve tvém měřítku (cm) díky Ms=100 v transformMatrix
+            s.y = c.y;
+            s.z = c.z;
+            s.intensity = c.intensity;
+            s.ftime = stamp;
+            s.rtime = static_cast<double>(c.time); // relativní od začátku linie
+            s.ring = static_cast<std::uint32_t>(j); // sloupec range image (vertikální úhel)
+            s.height = c.height;
+            s.label = c.label;
+            s.batch = batch;
+
+            pushSample(s);
+
+            // 8) Inkrementální update mřížky obsazenosti (překážky i negativní).
+            if (s.label == GroundSegmentation::kObstacle ||
+                s.label == GroundSegmentation::kNegative) {
+                grid_.insert(s.x, s.y, grid_now);
             }
         }
 
-        if (!found) {
-            return 5000.0f;
+        epoch_.store(epoch_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Epocha dat = počet zpracovaných paketů (klíč cache dotazů).
+    std::uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+    // Minimální vzdálenost překážky podle segmentace země
+    // (bod není země a je do GroundSegmentation::kMaxObstacleH nad ní).
+    // Vrací:
+    //   - sqrt(x^2 + y^2) [cm]
+    //   - -1 dokud není buffer plný
+    //   - 5000cm pokud v bufferu není žádná překážka.
+    float distance() const
+    {
+        return minDistance([](const Sample &p) {
+            return p.label == GroundSegmentation::kObstacle;
+        }, [](float x, float y) { return x * x + y * y; }, 5000.0f);
+    }
+
+    // Průběžný histogram vzdáleností překážek (robustní dotazy P/K, O(kBins)).
+    const DistanceHistogram &distanceHistogram() const { return hist_; }
+
+    // Minimální vzdálenost překážky v pevném rozsahu z∈[z_min,z_max] (v cm v rámci robota).
+    // Původní chování bez segmentace země.
+    float distance(float z_min, float z_max) const
+    {
+        return minDistance([z_min, z_max](const Sample &p) {
+            return p.z >= z_min && p.z <= z_max;
+        }, [](float x, float y) { return x * x + y * y; }, 5000.0f);
+    }
+
+    // Parametrizovaný dotaz (DistanceQuery): z-pásmo nebo segmentace země,
+    // azimut, max. stáří bodů (now = systémový čas [s]), footprint.
+    // Vrací -1 dokud není buffer plný, kMaxDistanceCm pokud nic nenajde.
+    // Robustní varianty (P/K) jdou přes histogram, azimut po celých sektorech.
+    float distance(const DistanceQuery &q, double now) const
+    {
+        if (size_ < kCapacity) {
+            return -1.0f;
+        }
+        if (q.robust()) {
+            int s_from = 0, s_to = DistanceHistogram::kSectors - 1;
+            if (q.use_az) {
+                const float k = static_cast<float>(M_PI) / 180.0f;
+                s_from = DistanceHistogram::sectorOf(std::cos(q.az_from * k), std::sin(q.az_from * k));
+                s_to   = DistanceHistogram::sectorOf(std::cos(q.az_to * k), std::sin(q.az_to * k));
+            }
+            const bool all = !q.use_az;
+            if (q.kth > 0) {
+                return all ? hist_.kth(q.kth) : hist_.kth(q.kth, s_from, s_to);
+            }
+            return all ? hist_.percentile(q.percentile) : hist_.percentile(q.percentile, s_from, s_to);
         }
 
-        return std::sqrt(min_sq);
+        const double t_min = q.max_age > 0.0f ? now - q.max_age : -1.0;
+        return minDistance([&q, t_min](const Sample &p) {
+            if (q.negative ? p.label != GroundSegmentation::kNegative
+                           : (q.use_z ? (p.z < q.z_min || p.z > q.z_max)
+                                      : p.label != GroundSegmentation::kObstacle)) {
+                return false;
+            }
+            return t_min < 0.0 || p.ftime + p.rtime >= t_min;
+        }, [&q](float x, float y) {
+            if (!q.inAzimuth(x, y)) return -1.0f;
+            if (!q.footprint) return x * x + y * y;
+            // vzdálenost k obdélníku robota (0 uvnitř)
+            const float dx = x < kBodyXMin ? kBodyXMin - x : (x > kBodyXMax ? x - kBodyXMax : 0.0f);
+            const float dy = y < kBodyYMin ? kBodyYMin - y : (y > kBodyYMax ? y - kBodyYMax : 0.0f);
+            return dx * dx + dy * dy;
+        }, kMaxDistanceCm * kMaxDistanceCm);
     }
 
     // Volitelně: snapshot bufferu (např. pro debug / další algoritmy).
@@ -103,14 +257,24 @@ public:
         return out;
     }
 
-    void clear() {
-        head_ = 0;
-        size_ = 0;
-        // buffer_ necháme jak je, stará data nám nevadí, stejně je size_==0
-    }
+    const StageStats &groundStats() const { return ground_stats_; }
+    const StageStats &deskewStats() const { return deskew_stats_; }
+    const StageStats &outlierStats() const { return outlier_stats_; }
+    const StageStats &negativeStats() const { return negative_stats_; }
+    const StageStats &heightStats() const { return height_stats_; }
+    const OutlierFilter &outlierFilter() const { return outliers_; }
+    const ImuHistory &imu() const { return imu_; }
+
+    // Kompenzace vlastního pohybu: body bufferu → aktuální rámec robota.
+    // Transformace se počítají líně, jednou na batch (platí pro jeden dotaz).
+    EgoCompensator compensator() const { return EgoCompensator(batches_, batches_.current()); }
+
+    // Přímý přístup k bufferu (čtení) pro algoritmy nad celým oknem bodů.
+    const Sample *data() const { return buffer_.data(); }
+    bool full() const { return size_ == kCapacity; }
 
-private:
     // ---------- Geometrie / transformace -----------------------------------
+    // Veřejné kvůli offline nástrojům (raw_convert) – stejné extrinsiky.
 
     static const Eigen::Matrix4f &transformMatrix()
     {
@@ -150,49 +314,101 @@ private:
     static bool ignoreBox(float x, float y)
     {
         // Kvádr robota ve cm v rámce robota; body uvnitř ignorujeme.
-        return (y > -20.0f && y <  20.0f &&
-                x <  20.0f && x > -50.0f);
+        return (y > kBodyYMin && y < kBodyYMax &&
+                x < kBodyXMax && x > kBodyXMin);
     }
 
-    static unilidar_sdk2::PointCloudUnitree
-    transformCloud(const unilidar_sdk2::PointCloudUnitree &src)
+    // Poloha LiDARu v rámci robota [cm] (translace transformMatrix()).
+    static Eigen::Vector3f sensorOrigin()
     {
         const Eigen::Matrix4f &T = transformMatrix();
-        unilidar_sdk2::PointCloudUnitree dst;
-        dst.stamp   = src.stamp;
-        dst.id      = src.id;
-        dst.ringNum = src.ringNum;
-        dst.points.reserve(src.points.size());
+        return Eigen::Vector3f(T(0,3), T(1,3), T(2,3));
+    }
 
-        Eigen::Vector4f p(0.0f, 0.0f, 0.0f, 1.0f);
+    // Mřížka obsazenosti (jen vlákno, které volá updatePacket()).
+    EgoOccupancyGrid &grid() { return grid_; }
+    HeightMap        &heightMap() { return height_; }
+    const RangeImage &rangeImage() const { return range_image_; }
+    const EgoOccupancyGrid &grid() const { return grid_; }
 
-        for (const auto &pt : src.points) {
-            p << pt.x, pt.y, pt.z, 1.0f;
-            Eigen::Vector4f q4 = T * p;
-            Eigen::Vector3f q  = q4.head<3>();
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+        grid_.clear();
+        height_.clear();
+        ground_.clear();
+        outliers_.clear();
+        hist_.clear();
+        range_image_.clear();
+        imu_.clear();
+        odom_.clear();
+        batches_.clear();
+        // buffer_ necháme jak je, stará data nám nevadí, stejně je size_==0
+    }
 
-            if (ignoreBox(q.x(), q.y())) {
-                continue;  // odfiltruj body robota
+private:
+    // Nejbližší bod splňující is_obstacle(sample); dist_sq(x, y) v aktuálním
+    // rámci robota vrací čtverec vzdálenosti nebo < 0 = bod přeskočit.
+    // cap_sq = počáteční minimum (DISTANCE historicky 5000 cm², tj. ~70 cm).
+    template <typename Pred, typename DistSq>
+    float minDistance(Pred is_obstacle, DistSq dist_sq, float cap_sq) const
+    {
+        if (size_ < kCapacity) {
+            return -1.0f;
+        }
+
+        float min_sq = cap_sq;
+        bool found = false;
+
+        // body v aktuálním rámci robota (kompenzace pohybu od záznamu)
+        EgoCompensator comp = compensator();
+
+        for (std::size_t i = 0; i < kCapacity; ++i) {
+            const Sample &p = buffer_[i];
+            if (!is_obstacle(p)) {
+                continue;
+            }
+
+            float x, y;
+            if (!comp.apply(p.batch, p.x, p.y, x, y)) continue;
+            const float d2 = dist_sq(x, y);
+            if (d2 >= 0.0f && d2 < min_sq) {
+                min_sq = d2;
+                found = true;
             }
+        }
 
-            unilidar_sdk2::PointUnitree o;
-            o.x = q.x();
-            o.y = q.y();
-            o.z = q.z();
-            o.intensity = pt.intensity;
-            o.time      = pt.time;   // stále relativní od cloud.stamp
-            o.ring      = pt.ring;
-            dst.points.push_back(o);
+        if (!found) {
+            return kMaxDistanceCm;
         }
 
-        return dst;
+        return std::sqrt(min_sq);
     }
 
     // ---------- Ring buffer -------------------------------------------------
+    //
+    // Range image drží geometrii (sousedé pro zem, prach, hrany, normály,
+    // náhled cloudu), dotazy ale dál jdou přes kopii platných buněk sem:
+    //  • okno dotazů je posledních kCapacity bodů bez ohledu na otáčky –
+    //    řádek range image se přepíše s dalším průchodem stejného úhlu,
+    //    v řídké scéně ring sahá přes víc otáček, range image jen do poslední;
+    //  • vzorek nese čas linie a batch pro kompenzaci pohybu, buňka ne;
+    //  • přepsání slotu je jediné místo, kde DistanceHistogram odebírá bod;
+    //  • koridory / shluky / DISTANCE procházejí souvislé pole ~48 B vzorků
+    //    místo 1024 × 300 buněk, z nichž je platná jen část.
+    // Cena je jedna 48B kopie na platný bod.
 
     void pushSample(const Sample &s)
     {
-        buffer_[static_cast<std::size_t>(head_)] = s;
+        // histogram vzdáleností: přepisovaný bod ven, nový dovnitř
+        Sample &slot = buffer_[static_cast<std::size_t>(head_)];
+        if (size_ == kCapacity && slot.label == GroundSegmentation::kObstacle) {
+            hist_.remove(slot.x, slot.y);
+        }
+        if (s.label == GroundSegmentation::kObstacle) {
+            hist_.add(s.x, s.y);
+        }
+        slot = s;
 
         // posun indexu (uint16_t overflow → mod 2^16)
         ++head_;
@@ -201,8 +417,8 @@ private:
             ++size_;
         }
 
-        // Přetečení (head_ == 0) *a* buffer je plný → dump do PLY.
-        if (size_ == kCapacity && head_ == 0) {
+        // Přetečení (head_ == 0) *a* buffer je plný → dump do PLY (pokud je povolený).
+        if (ply_dump_ && size_ == kCapacity && head_ == 0) {
             dumpBufferToPly();
         }
     }
@@ -271,6 +487,8 @@ private:
         ofs << "property double ftime\n";
         ofs << "property double rtime\n";
         ofs << "property uint32 ring\n";
+        ofs << "property float height\n";
+        ofs << "property uint8 label\n";
         ofs << "end_header\n";
 
         // data: pro jednoduchost v pořadí [0..N-1] v bufferu
@@ -283,7 +501,9 @@ private:
                 << p.intensity << " "
                 << p.ftime << " "
                 << p.rtime << " "
-                << p.ring << "\n";
+                << p.ring << " "
+                << p.height << " "
+                << static_cast<unsigned>(p.label) << "\n";
         }
     }
 
@@ -291,4 +511,23 @@ private:
     std::array<Sample, kCapacity> buffer_{};
     std::uint16_t head_{0};   // index pro další zápis (automaticky přeteče mod 2^16)
     std::size_t   size_{0};   // počet platných prvků (<= kCapacity)
+    bool          ply_dump_{true};
+
+    RangeImage         range_image_;
+    EgoOccupancyGrid   grid_;
+    HeightMap          height_;
+    GroundSegmentation ground_;
+    OutlierFilter      outliers_;
+    NegativeObstacleDetector negative_;
+    DistanceHistogram  hist_;
+    std::atomic<std::uint64_t> epoch_{0};
+    ImuHistory         imu_;
+    OdomInput          odom_;
+    PoseTracker        pose_{imu_, odom_};
+    BatchPoses         batches_;
+    StageStats         ground_stats_;
+    StageStats         deskew_stats_;
+    StageStats         outlier_stats_;
+    StageStats         negative_stats_;
+    StageStats         height_stats_;
 };
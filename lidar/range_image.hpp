@@ -0,0 +1,185 @@
+#pragma once
+
+// range_image.hpp — organizovaný cloud (range image) přímo z paketů LiDARu
+// ---------------------------------------------------------------------------
+// • Každý LidarPointDataPacket = jedna skenovací linie (až 300 bodů).
+//     řádek   = horizontální úhel linie (com_horizontal_angle_start), kRows binů na 2π
+//     sloupec = index bodu v linii, tj. vertikální úhel angle_min + j·angle_increment
+// • decode() zapisuje body rovnou do buněk řádku (žádný mezilehlý
+//   PointCloudUnitree ani kopie), včetně transformace do rámce robota [cm].
+// • Sousedé bodu jsou at(row±1, col) a at(row, col±1) → O(1) přístup pro
+//   normály, segmentaci země, clustering, filtraci prachu.
+// • Řádek nese čas a pořadí otáčky; stará data se poznají podle stamp/rev,
+//   nic se nemaže.
+// • Volitelný deskew (LineDeskew z ImuHistory): bod se před transformací
+//   natočí v rámci LiDARu podle svého času v linii.
+// • Buňka bez platného měření (range 0, mimo rozsah, tělo robota) má range_mm == 0.
+// • Dotazy přes čas (DISTANCE, koridory, shluky) dál čtou ring buffer
+//   LidarPointProcessing – proč, viz komentář u pushSample().
+// ---------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "unitree_lidar_protocol.h"
+#include "imu_deskew.hpp"
+
+class RangeImage
+{
+public:
+    static constexpr int kRows = 1024;   // ~0.35° horizontálně
+    static constexpr int kCols = 300;    // max. point_num v paketu
+
+    struct Cell {
+        float x, y, z;            // rámec robota [cm]
+        float time;               // relativní čas bodu od stamp řádku [s]
+        float height;             // výška nad lokální zemí [cm] (GroundSegmentation)
+        std::uint16_t range_mm;   // 0 = neplatná buňka
+        std::uint8_t  intensity;
+        std::uint8_t  label;      // GroundSegmentation::Label
+
+        bool valid() const { return range_mm != 0; }
+    };
+
+    struct Row {
+        double        stamp = -1.0;   // absolutní čas začátku linie [s]
+        float         h_angle = 0.0f; // horizontální úhel linie [rad]
+        std::uint32_t seq = 0;        // info.seq paketu
+        std::uint32_t rev = 0;        // pořadí otáčky
+        std::uint16_t n = 0;          // počet sloupců (point_num)
+    };
+
+    RangeImage() : cells_(static_cast<std::size_t>(kRows) * kCols), rows_(kRows) {}
+
+    void clear()
+    {
+        for (auto &r : rows_) r = Row{};
+        for (auto &c : cells_) c.range_mm = 0;
+    }
+
+    // Dekóduje paket do jeho řádku; vrací index řádku.
+    // T = transformace lidar [m] → robot [cm]; ignore(x,y) = tělo robota.
+    template <typename IgnoreFn>
+    int decode(const unilidar_sdk2::LidarPointDataPacket &packet,
+               double stamp,
+               std::uint32_t rev,
+               const Eigen::Matrix4f &T,
+               IgnoreFn ignore,
+               const LineDeskew &deskew = LineDeskew{})
+    {
+        const auto &d = packet.data;
+        const float theta0 = d.com_horizontal_angle_start + d.param.theta_angle_bias;
+        const int r = rowOf(theta0);
+
+        Row &row = rows_[r];
+        row.stamp   = stamp;
+        row.h_angle = theta0;
+        row.seq     = d.info.seq;
+        row.rev     = rev;
+
+        Cell *out = rowData(r);
+        row.n = static_cast<std::uint16_t>(decodeInto(packet, T, ignore, out, deskew));
+        return r;
+    }
+
+    // Samotné dekódování paketu do pole buněk (kCols). Sdílené s offline nástroji.
+    // Vzorce odpovídají unilidar_sdk2::parseFromPacketToPointCloud().
+    template <typename IgnoreFn>
+    static int decodeInto(const unilidar_sdk2::LidarPointDataPacket &packet,
+                          const Eigen::Matrix4f &T,
+                          IgnoreFn ignore,
+                          Cell *out,
+                          const LineDeskew &deskew = LineDeskew{})
+    {
+        const auto &d = packet.data;
+        const int n = static_cast<int>(d.point_num < static_cast<std::uint32_t>(kCols)
+                                           ? d.point_num : kCols);
+
+        const float sin_beta = std::sin(d.param.beta_angle);
+        const float cos_beta = std::cos(d.param.beta_angle);
+        const float sin_xi   = std::sin(d.param.xi_angle);
+        const float cos_xi   = std::cos(d.param.xi_angle);
+        const float cos_beta_sin_xi = cos_beta * sin_xi;
+        const float sin_beta_cos_xi = sin_beta * cos_xi;
+        const float sin_beta_sin_xi = sin_beta * sin_xi;
+        const float cos_beta_cos_xi = cos_beta * cos_xi;
+
+        float alpha = d.angle_min + d.param.alpha_angle_bias;
+        float theta = d.com_horizontal_angle_start + d.param.theta_angle_bias;
+        float t_rel = 0.0f;
+        const float u_step = n > 1 ? 1.0f / static_cast<float>(n - 1) : 0.0f;
+
+        for (int j = 0; j < n; ++j, alpha += d.angle_increment,
+                 theta += d.com_horizontal_angle_step, t_rel += d.time_increment) {
+            Cell &c = out[j];
+            c.range_mm  = 0;
+            c.label     = 0;
+            c.height    = 0.0f;
+            c.intensity = d.intensities[j];
+            c.time      = t_rel;
+
+            if (d.ranges[j] < 1) continue;
+
+            const float range = d.param.range_scale *
+                                (static_cast<float>(d.ranges[j]) + d.param.range_bias);
+            if (range < d.range_min || range > d.range_max) continue;
+
+            const float sa = std::sin(alpha), ca = std::cos(alpha);
+            const float st = std::sin(theta), ct = std::cos(theta);
+
+            const float A = (-cos_beta_sin_xi + sin_beta_cos_xi * sa) * range + d.param.b_axis_dist;
+            const float B = ca * cos_xi * range;
+            const float C = (sin_beta_sin_xi + cos_beta_cos_xi * sa) * range;
+
+            float lx = ct * A - st * B;
+            float ly = st * A + ct * B;
+            float lz = C + d.param.a_axis_dist;
+
+            if (deskew.enabled) {
+                const Eigen::Matrix3f R = deskew.R0 + deskew.dR * (u_step * static_cast<float>(j));
+                const float rx = R(0,0) * lx + R(0,1) * ly + R(0,2) * lz;
+                const float ry = R(1,0) * lx + R(1,1) * ly + R(1,2) * lz;
+                const float rz = R(2,0) * lx + R(2,1) * ly + R(2,2) * lz;
+                lx = rx; ly = ry; lz = rz;
+            }
+
+            const float x = T(0,0) * lx + T(0,1) * ly + T(0,2) * lz + T(0,3);
+            const float y = T(1,0) * lx + T(1,1) * ly + T(1,2) * lz + T(1,3);
+            const float z = T(2,0) * lx + T(2,1) * ly + T(2,2) * lz + T(2,3);
+
+            if (ignore(x, y)) continue;
+
+            c.x = x; c.y = y; c.z = z;
+            c.range_mm = d.ranges[j];
+        }
+        for (int j = n; j < kCols; ++j) out[j].range_mm = 0;
+        return n;
+    }
+
+    static int rowOf(float h_angle)
+    {
+        constexpr float k2Pi = 2.0f * static_cast<float>(M_PI);
+        float a = std::fmod(h_angle, k2Pi);
+        if (a < 0.0f) a += k2Pi;
+        const int r = static_cast<int>(a * (kRows / k2Pi));
+        return r >= kRows ? kRows - 1 : r;
+    }
+
+    static int rowNext(int r) { return r + 1 == kRows ? 0 : r + 1; }
+    static int rowPrev(int r) { return r == 0 ? kRows - 1 : r - 1; }
+
+    Cell       *rowData(int r)       { return &cells_[static_cast<std::size_t>(r) * kCols]; }
+    const Cell *rowData(int r) const { return &cells_[static_cast<std::size_t>(r) * kCols]; }
+
+    Cell       &at(int r, int c)       { return cells_[static_cast<std::size_t>(r) * kCols + c]; }
+    const Cell &at(int r, int c) const { return cells_[static_cast<std::size_t>(r) * kCols + c]; }
+
+    const Row &row(int r) const { return rows_[r]; }
+
+private:
+    std::vector<Cell> cells_;   // kRows × kCols, řádek souvisle
+    std::vector<Row>  rows_;
+};
@@ -0,0 +1,411 @@
+// raw_convert.cpp — převod syrového logu LiDARu (L2RAW01/02/03) na PLY / PCD / LAS
+// -----------------------------------------------------------------
+// • lidar_raw_convert [-f ply|pcd|las] [-j N] [--deskew] [--from s] [--to s] in.dat out
+// • Body se dekódují stejně jako ve službě: RangeImage::decodeInto se
+//   stejnými extrinsikami (LidarPointProcessing::transformMatrix) a ořezem
+//   kvádru robota; --deskew = natočení bodů linie podle gyra (ImuHistory),
+//   referenční čas jako živě (poslední IMU vzorek / konec linie).
+// • Výstup v rámci robota [m], bez odometrie (každý bod má čas t):
+//     PLY / PCD: binární, x y z (float) intensity (uchar) ring (ushort) t (float,
+//                [s] od prvního záznamu logu); ring = sloupec = vertikální úhel
+//     LAS 1.2:   point format 1, měřítko 1 mm, gps_time = monotónní čas [s]
+// • Paralelně: log se rozdělí na časové úseky podle indexu (.idx / průchod
+//   hlaviček), jeden na vlákno ParallelFor. Každé vlákno zapisuje do
+//   vlastního dočasného souboru out.partN; na konci hlavička + spojení
+//   přes copy_file_range. Deskew na začátku úseku "předehřeje" IMU
+//   z kWarmupNs před ním.
+// • Build: součást CMakeLists.txt (cíl lidar_raw_convert).
+// -----------------------------------------------------------------
+
+#include "point_processing.hpp"
+#include "raw_log_mapped.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Packet = unilidar_sdk2::LidarPointDataPacket;
+using ImuPacket = unilidar_sdk2::LidarImuDataPacket;
+
+constexpr uint64_t kWarmupNs = 500000000ull;   // IMU historie před úsekem (deskew)
+constexpr double   kLasScale = 0.001;           // [m]
+
+enum class Format { Ply, Pcd, Las };
+
+#pragma pack(push, 1)
+struct PointRec            // PLY / PCD
+{
+    float    x, y, z;
+    uint8_t  intensity;
+    uint16_t ring;
+    float    t;
+};
+
+struct LasPoint            // LAS 1.2, point data format 1
+{
+    int32_t  x, y, z;
+    uint16_t intensity;
+    uint8_t  return_bits;  // return number 1 / number of returns 1
+    uint8_t  classification;
+    int8_t   scan_angle;
+    uint8_t  user_data;
+    uint16_t point_source;
+    double   gps_time;
+};
+
+struct LasHeader           // LAS 1.2 public header block
+{
+    char     signature[4];
+    uint16_t file_source_id;
+    uint16_t global_encoding;
+    uint32_t guid1;
+    uint16_t guid2;
+    uint16_t guid3;
+    uint8_t  guid4[8];
+    uint8_t  version_major;
+    uint8_t  version_minor;
+    char     system_id[32];
+    char     software[32];
+    uint16_t day_of_year;
+    uint16_t year;
+    uint16_t header_size;
+    uint32_t point_offset;
+    uint32_t n_vlr;
+    uint8_t  point_format;
+    uint16_t point_size;
+    uint32_t n_points;
+    uint32_t n_by_return[5];
+    double   scale[3];
+    double   offset[3];
+    double   max_x, min_x, max_y, min_y, max_z, min_z;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PointRec) == 19, "PointRec must be packed");
+static_assert(sizeof(LasPoint) == 28, "LAS point format 1 is 28 bytes");
+static_assert(sizeof(LasHeader) == 227, "LAS 1.2 header is 227 bytes");
+
+struct Options
+{
+    Format      format = Format::Ply;
+    unsigned    threads = 0;
+    bool        deskew = false;
+    double      from_s = 0.0;       // [s] od prvního záznamu
+    double      to_s = std::numeric_limits<double>::infinity();
+    std::string in, out;
+};
+
+// Výsledek jednoho úseku (vlákna).
+struct Slice
+{
+    std::string path;
+    FILE       *f = nullptr;
+    uint64_t    points = 0;
+    uint64_t    packets = 0;
+    double      min[3] = { 1e30,  1e30,  1e30};
+    double      max[3] = {-1e30, -1e30, -1e30};
+    bool        ok = true;
+};
+
+void usage()
+{
+    std::fprintf(stderr,
+                 "usage: lidar_raw_convert [-f ply|pcd|las] [-j threads] [--deskew]\n"
+                 "                         [--from s] [--to s] <in.dat> <out>\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &o)
+{
+    std::vector<std::string> pos;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool has_val = i + 1 < argc;
+        if (a == "-f" && has_val) {
+            const std::string f = argv[++i];
+            if (f == "ply") o.format = Format::Ply;
+            else if (f == "pcd") o.format = Format::Pcd;
+            else if (f == "las") o.format = Format::Las;
+            else return false;
+        } else if (a == "-j" && has_val) {
+            o.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (a == "--deskew") {
+            o.deskew = true;
+        } else if (a == "--from" && has_val) {
+            o.from_s = std::atof(argv[++i]);
+        } else if (a == "--to" && has_val) {
+            o.to_s = std::atof(argv[++i]);
+        } else if (!a.empty() && a[0] == '-') {
+            return false;
+        } else {
+            pos.push_back(a);
+        }
+    }
+    if (pos.size() != 2) return false;
+    o.in = pos[0];
+    o.out = pos[1];
+    return true;
+}
+
+// Jeden úsek logu [from, to) (offsety) → slice.f. Záznamy od warm do from
+// jen plní IMU historii.
+void convertSlice(const RawLogMapped &log, uint64_t warm, uint64_t from, uint64_t to,
+                  uint64_t t0_ns, uint64_t ts_from, uint64_t ts_to,
+                  const Options &o, Slice &s)
+{
+    const Eigen::Matrix4f &T = LidarPointProcessing::transformMatrix();
+    ImuHistory imu;
+    imu.setYawAxis(Eigen::Vector3f(T(2,0), T(2,1), T(2,2)));
+
+    std::vector<RangeImage::Cell> cells(RangeImage::kCols);
+    std::vector<PointRec> recs;
+    std::vector<LasPoint> las;
+    recs.reserve(RangeImage::kCols);
+    las.reserve(RangeImage::kCols);
+    Packet pkt_copy;
+    ImuPacket imu_copy;
+
+    RawLogMapped::Iterator it(&log, o.deskew ? warm : from, to);
+    for (; it != log.end(); ++it) {
+        const RawLogView &v = *it;
+        const uint64_t ts = v.monoTs();
+        const double stamp = static_cast<double>(ts) * 1e-9;
+
+        if (v.type() == RawRecordType::Imu) {
+            const ImuPacket *ip = v.imu();
+            if (!ip && v.copyTo(imu_copy)) ip = &imu_copy;
+            if (ip && o.deskew) imu.push(stamp, ip->data.angular_velocity);
+            continue;
+        }
+        if (v.offset < from || ts < ts_from || ts > ts_to) continue;
+        const Packet *pp = v.point();
+        if (!pp && v.copyTo(pkt_copy)) pp = &pkt_copy;
+        if (!pp) continue;
+        const Packet &pkt = *pp;
+
+        // čas začátku linie jako ve službě (čas přijetí - scan_period)
+        const double line_t = stamp - pkt.data.scan_period;
+        LineDeskew deskew;
+        if (o.deskew) {
+            const double span = static_cast<double>(pkt.data.time_increment) *
+                                (pkt.data.point_num > 0 ? pkt.data.point_num - 1 : 0);
+            deskew = imu.deskewFor(line_t, span, std::max(imu.latestStamp(), line_t + span));
+        }
+        const int n = RangeImage::decodeInto(pkt, T, LidarPointProcessing::ignoreBox,
+                                             cells.data(), deskew);
+        ++s.packets;
+
+        recs.clear();
+        las.clear();
+        for (int j = 0; j < n; ++j) {
+            const RangeImage::Cell &c = cells[j];
+            if (!c.valid()) continue;
+            const double p[3] = {c.x * 0.01, c.y * 0.01, c.z * 0.01};
+            for (int k = 0; k < 3; ++k) {
+                s.min[k] = std::min(s.min[k], p[k]);
+                s.max[k] = std::max(s.max[k], p[k]);
+            }
+            const double t_abs = line_t + c.time;
+            if (o.format == Format::Las) {
+                LasPoint q{};
+                q.x = static_cast<int32_t>(std::lround(p[0] / kLasScale));
+                q.y = static_cast<int32_t>(std::lround(p[1] / kLasScale));
+                q.z = static_cast<int32_t>(std::lround(p[2] / kLasScale));
+                q.intensity = c.intensity;
+                q.return_bits = 1 | (1 << 3);
+                q.point_source = static_cast<uint16_t>(j);
+                q.gps_time = t_abs;
+                las.push_back(q);
+            } else {
+                PointRec q;
+                q.x = static_cast<float>(p[0]);
+                q.y = static_cast<float>(p[1]);
+                q.z = static_cast<float>(p[2]);
+                q.intensity = c.intensity;
+                q.ring = static_cast<uint16_t>(j);
+                q.t = static_cast<float>(t_abs - static_cast<double>(t0_ns) * 1e-9);
+                recs.push_back(q);
+            }
+        }
+        const std::size_t cnt = o.format == Format::Las ? las.size() : recs.size();
+        const std::size_t w = o.format == Format::Las
+                                  ? std::fwrite(las.data(), sizeof(LasPoint), cnt, s.f)
+                                  : std::fwrite(recs.data(), sizeof(PointRec), cnt, s.f);
+        if (w != cnt) s.ok = false;
+        s.points += cnt;
+    }
+    if (!it.clean()) {
+        std::fprintf(stderr, "warning: %s: slice ended on damaged data\n", o.in.c_str());
+    }
+}
+
+bool writeHeader(FILE *f, const Options &o, const Slice &total)
+{
+    if (o.format == Format::Ply) {
+        return std::fprintf(f,
+                            "ply\nformat binary_little_endian 1.0\n"
+                            "element vertex %llu\n"
+                            "property float x\nproperty float y\nproperty float z\n"
+                            "property uchar intensity\nproperty ushort ring\nproperty float t\n"
+                            "end_header\n",
+                            static_cast<unsigned long long>(total.points)) > 0;
+    }
+    if (o.format == Format::Pcd) {
+        return std::fprintf(f,
+                            "# .PCD v0.7 - Point Cloud Data file format\n"
+                            "VERSION 0.7\nFIELDS x y z intensity ring t\n"
+                            "SIZE 4 4 4 1 2 4\nTYPE F F F U U F\nCOUNT 1 1 1 1 1 1\n"
+                            "WIDTH %llu\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\n"
+                            "POINTS %llu\nDATA binary\n",
+                            static_cast<unsigned long long>(total.points),
+                            static_cast<unsigned long long>(total.points)) > 0;
+    }
+    LasHeader h{};
+    std::memcpy(h.signature, "LASF", 4);
+    h.version_major = 1;
+    h.version_minor = 2;
+    std::strncpy(h.system_id, "Unitree L2", sizeof(h.system_id));
+    std::strncpy(h.software, "lidar_raw_convert", sizeof(h.software));
+    const std::time_t now = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&now, &tm);
+    h.day_of_year = static_cast<uint16_t>(tm.tm_yday + 1);
+    h.year = static_cast<uint16_t>(tm.tm_year + 1900);
+    h.header_size = sizeof(LasHeader);
+    h.point_offset = sizeof(LasHeader);
+    h.point_format = 1;
+    h.point_size = sizeof(LasPoint);
+    h.n_points = static_cast<uint32_t>(std::min<uint64_t>(total.points, UINT32_MAX));
+    h.n_by_return[0] = h.n_points;
+    h.scale[0] = h.scale[1] = h.scale[2] = kLasScale;
+    const bool any = total.points > 0;
+    h.min_x = any ? total.min[0] : 0; h.max_x = any ? total.max[0] : 0;
+    h.min_y = any ? total.min[1] : 0; h.max_y = any ? total.max[1] : 0;
+    h.min_z = any ? total.min[2] : 0; h.max_z = any ? total.max[2] : 0;
+    return std::fwrite(&h, sizeof(h), 1, f) == 1;
+}
+
+// Připojí soubor part na konec out_fd (jádro kopíruje bez průchodu userspace).
+bool appendFile(int out_fd, const std::string &part)
+{
+    const int in = ::open(part.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    bool ok = true;
+    for (;;) {
+        const ssize_t n = ::copy_file_range(in, nullptr, out_fd, nullptr, 1u << 30, 0);
+        if (n == 0) break;
+        if (n > 0) continue;
+        // copy_file_range nepodporováno (starší jádro / FS) → read/write
+        std::vector<char> buf(1u << 20);
+        ssize_t r;
+        while ((r = ::read(in, buf.data(), buf.size())) > 0) {
+            if (::write(out_fd, buf.data(), static_cast<std::size_t>(r)) != r) { ok = false; break; }
+        }
+        ok = ok && r == 0;
+        break;
+    }
+    ::close(in);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options o;
+    if (!parseArgs(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+
+    RawLogMapped log;
+    std::string err;
+    if (!log.open(o.in, &err)) {
+        std::fprintf(stderr, "error: %s\n", err.c_str());
+        return 1;
+    }
+    const auto &entries = log.index().entries;
+    if (entries.empty()) {
+        std::fprintf(stderr, "error: %s: no records\n", o.in.c_str());
+        return 1;
+    }
+
+    const auto t_start = std::chrono::steady_clock::now();
+    const uint64_t t0_ns = entries.front().mono_ts_ns;
+    const uint64_t ts_from = t0_ns + static_cast<uint64_t>(std::max(0.0, o.from_s) * 1e9);
+    const uint64_t ts_to = std::isfinite(o.to_s)
+                               ? t0_ns + static_cast<uint64_t>(std::max(0.0, o.to_s) * 1e9)
+                               : std::numeric_limits<uint64_t>::max();
+
+    // položky indexu v časovém okně → úseky
+    const long e0 = log.index().findTime(ts_from);
+    long e1 = static_cast<long>(entries.size());
+    while (e1 > e0 + 1 && entries[e1 - 1].mono_ts_ns > ts_to) --e1;
+
+    ParallelFor pool(o.threads);
+    std::vector<Slice> slices(pool.threads());
+    for (unsigned i = 0; i < slices.size(); ++i) {
+        slices[i].path = o.out + ".part" + std::to_string(i);
+        slices[i].f = std::fopen(slices[i].path.c_str(), "wb");
+        if (!slices[i].f) {
+            std::fprintf(stderr, "error: cannot create %s\n", slices[i].path.c_str());
+            return 1;
+        }
+        std::setvbuf(slices[i].f, nullptr, _IOFBF, 1u << 20);
+    }
+
+    pool.run(static_cast<int>(e1 - e0), [&](int b, int e, int worker) {
+        const long first = e0 + b;
+        const uint64_t from = first == 0 ? 8 : entries[first].offset;
+        const uint64_t to = e0 + e >= static_cast<long>(entries.size()) ? log.size()
+                                                                         : entries[e0 + e].offset;
+        const uint64_t warm_ts = entries[first].mono_ts_ns > kWarmupNs
+                                     ? entries[first].mono_ts_ns - kWarmupNs : 0;
+        const long w = log.index().findTime(warm_ts);
+        const uint64_t warm = w <= 0 ? 8 : entries[w].offset;
+        convertSlice(log, std::min(warm, from), from, to, t0_ns, ts_from, ts_to, o, slices[worker]);
+    });
+
+    Slice total;
+    bool ok = true;
+    for (auto &s : slices) {
+        ok = ok && s.ok && std::fclose(s.f) == 0;
+        total.points += s.points;
+        total.packets += s.packets;
+        for (int k = 0; k < 3; ++k) {
+            total.min[k] = std::min(total.min[k], s.min[k]);
+            total.max[k] = std::max(total.max[k], s.max[k]);
+        }
+    }
+
+    FILE *out = std::fopen(o.out.c_str(), "wb");
+    ok = ok && out && writeHeader(out, o, total) && std::fflush(out) == 0;
+    for (auto &s : slices) {
+        ok = ok && appendFile(fileno(out), s.path);
+        std::remove(s.path.c_str());
+    }
+    if (out) ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::fprintf(stderr, "error: writing %s failed\n", o.out.c_str());
+        return 1;
+    }
+
+    const double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    std::fprintf(stderr, "%s: %llu packets, %llu points, %u threads, %.2f s\n",
+                 o.out.c_str(), static_cast<unsigned long long>(total.packets),
+                 static_cast<unsigned long long>(total.points), pool.threads(), dt);
+    return 0;
+}
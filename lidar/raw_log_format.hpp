@@ -0,0 +1,485 @@
+#pragma once
+
+// raw_log_format.hpp — formát syrového logu LiDARu (L2RAW01 / 02 / 03)
+// ---------------------------------------------------------------------------
+// • L2RAW01: magic "L2RAW01\0", pak záznamy LogRecordHeader + payload paketu
+//   (payload = paket tak, jak přišel z LiDARu, header.packet_size bajtů).
+//   Zapisovač záznam "zapečetí": reserved[0] = kRecordSync (synchronizační
+//   značka), reserved[1..2] = dolních 16 bitů CRC32C hlavičky + payloadu
+//   (sealRecord / recordOk). Starší čtečky reserved ignorují; záznam bez
+//   značky (starý log) se bere bez kontroly.
+// • L2RAW02: magic "L2RAW02\0", pak bloky LogBlockHeader + tělo. Blok nese
+//   stejné záznamy jako L2RAW01 a dekóduje se samostatně (stav kodéru se na
+//   začátku bloku nuluje) → soubor je streamovatelný, useknutý konec stojí
+//   jen poslední blok.
+// • L2RAW03: jako L2RAW02, za každou LogBlockHeader navíc LogBlockCrc –
+//   CRC32C hlavičky (kandidát na "L2BK" při resynchronizaci se ověří bez
+//   čtení těla) a CRC32C uloženého těla. Blok je nejmenší samostatně
+//   dekódovatelná jednotka (záznamy v něm jsou kódované proti sobě), proto
+//   kontrolní součet na úrovni bloku; blok má max. kFlushIntervalNs dat.
+//   Zapisuje se jen L2RAW03, L2RAW02 se dál čte.
+// • Tělo bloku (před volitelným zstd), pro každý záznam:
+//       u8 type, varint Δmono_ts_ns, varint payload_size, pak payload:
+//   - point paket (1044 B): hlavička, stav, kalibrace, info o linii a tail
+//     jako XOR s předchozím point paketem bloku + běhy nul (kalibrace a stav
+//     se opakují → pár bajtů), ranges[300] a intensities[300] jako zigzag
+//     delta po sloupcích, bit-packing po skupinách kGroup hodnot (bajt šířky
+//     + bity; skupina samých nul = 1 bajt),
+//   - ostatní (IMU, VERSION, ANNOTATION, neznámá velikost): XOR s předchozím záznamem
+//     stejného typu + běhy nul.
+//   Běhy nul: opakovaně varint počet nul, varint počet literálů, literály.
+// • Volitelně zstd nad celým tělem (LIDAR_LOG_ZSTD z CMake, jen když je
+//   knihovna k dispozici). Bez ní codec = kCodecPacked.
+// • blockHeaderOk / blockBodyOk: kontrola bloku (čtečky, lidar_raw_recover).
+// • RawLogBlockEncoder / decodeRawLogBlock: kódování na vlákně zapisovače
+//   (LidarRawLogger), dekódování pro čtečky a offline nástroje. Výstup
+//   dekodéru je proud záznamů ve tvaru L2RAW01.
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "unitree_lidar_protocol.h"  // LidarPointDataPacket, LidarImuDataPacket, LidarVersionDataPacket
+
+#if defined(LIDAR_LOG_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define LIDAR_LOG_HAVE_ZSTD 1
+#else
+#define LIDAR_LOG_HAVE_ZSTD 0
+#endif
+
+enum class RawRecordType : uint8_t {
+    Point   = 1,
+    Imu     = 2,
+    Version = 3,
+    Annotation = 4,   // text: výsledky zpracování / události (BlackBoxRecorder)
+};
+
+#pragma pack(push, 1)
+struct LogRecordHeader
+{
+    uint8_t  type;           // viz RawRecordType
+    uint8_t  reserved[3];    // L2RAW01: [0] = kRecordSync, [1..2] = CRC16 (sealRecord), jinak 0
+    uint64_t mono_ts_ns;     // monotonic timestamp hosta v ns
+    uint32_t payload_size;   // velikost payloadu v bajtech (mělo by odpovídat header.packet_size)
+};
+
+struct LogBlockHeader
+{
+    char     magic[4];       // "L2BK" – zároveň synchronizační značka
+    uint8_t  codec;          // kCodecPacked / kCodecZstd
+    uint8_t  reserved[3];
+    uint32_t n_records;
+    uint32_t raw_size;       // bajty záznamů ve tvaru L2RAW01 (hlavičky + payloady)
+    uint32_t packed_size;    // tělo po bit-packingu (před zstd)
+    uint32_t stored_size;    // bajty těla za touto hlavičkou
+    uint64_t first_ts_ns;    // mono_ts_ns prvního / posledního záznamu
+    uint64_t last_ts_ns;
+    uint32_t first_seq;      // info.seq prvního point paketu (0 = žádný)
+    uint32_t last_seq;
+};
+
+struct LogBlockCrc           // L2RAW03: hned za LogBlockHeader
+{
+    uint32_t header_crc;     // CRC32C LogBlockHeader (48 B)
+    uint32_t body_crc;       // CRC32C stored_size bajtů těla
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LogBlockCrc) == 8, "LogBlockCrc must be packed as 8 bytes");
+static_assert(sizeof(LogRecordHeader) == 1 + 3 + 8 + 4,
+              "LogRecordHeader must be packed as 16 bytes");
+static_assert(sizeof(LogBlockHeader) == 48, "LogBlockHeader must be packed as 48 bytes");
+
+namespace rawlog {
+
+constexpr char kMagicV1[8] = {'L','2','R','A','W','0','1','\0'};
+constexpr char kMagicV2[8] = {'L','2','R','A','W','0','2','\0'};
+constexpr char kMagicV3[8] = {'L','2','R','A','W','0','3','\0'};
+constexpr char kBlockMagic[4] = {'L','2','B','K'};
+constexpr uint8_t kRecordSync = 0xA5;   // LogRecordHeader::reserved[0] zapečetěného záznamu
+
+constexpr uint8_t kCodecPacked = 0;
+constexpr uint8_t kCodecZstd   = 1;
+constexpr int     kZstdLevel   = 1;     // rychlost > poměr (běží na robotu)
+
+constexpr int kGroup = 16;              // hodnot na bajt šířky
+
+using Packet = unilidar_sdk2::LidarPointDataPacket;
+constexpr std::size_t kPointSize   = sizeof(Packet);
+constexpr std::size_t kRangesOff   = offsetof(Packet, data.ranges);
+constexpr std::size_t kIntensOff   = offsetof(Packet, data.intensities);
+constexpr std::size_t kRestOff     = kIntensOff + sizeof(Packet::data.intensities);
+constexpr int         kPointCols   = sizeof(Packet::data.ranges) / sizeof(uint16_t);
+constexpr std::size_t kMaxPayload  = 1u << 16;   // víc = poškozený záznam
+constexpr std::size_t kMaxBlockRaw = 64u << 20;  // víc = poškozená hlavička bloku
+
+inline bool isMagicV1(const void *p) { return std::memcmp(p, kMagicV1, 8) == 0; }
+inline bool isMagicV2(const void *p) { return std::memcmp(p, kMagicV2, 8) == 0; }
+inline bool isMagicV3(const void *p) { return std::memcmp(p, kMagicV3, 8) == 0; }
+inline bool isBlockMagic(const void *p) { return std::memcmp(p, kBlockMagic, 4) == 0; }
+
+// Verze podle magicu (0 = neznámý).
+inline int magicVersion(const void *p)
+{
+    return isMagicV1(p) ? 1 : isMagicV2(p) ? 2 : isMagicV3(p) ? 3 : 0;
+}
+
+// Hlavička bloku včetně LogBlockCrc (L2RAW03).
+inline std::size_t blockHeaderSize(int version)
+{
+    return sizeof(LogBlockHeader) + (version >= 3 ? sizeof(LogBlockCrc) : 0);
+}
+
+// CRC32C (Castagnoli), softwarově slicing-by-8 (~1–2 GB/s, bez závislosti
+// na SSE4.2 / ARMv8 CRC rozšíření).
+inline uint32_t crc32c(const void *data, std::size_t n, uint32_t crc = 0)
+{
+    struct Table {
+        uint32_t t[8][256];
+        Table()
+        {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1u)));
+                t[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+            }
+        }
+    };
+    static const Table tab;
+    const auto &t = tab.t;
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    while (n--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+// CRC16 záznamu L2RAW01: hlavička s nulovým reserved + payload.
+inline uint16_t recordCrc(const LogRecordHeader &h, const uint8_t *payload)
+{
+    LogRecordHeader z = h;
+    std::memset(z.reserved, 0, sizeof(z.reserved));
+    return static_cast<uint16_t>(crc32c(payload, h.payload_size, crc32c(&z, sizeof(z))));
+}
+
+inline void sealRecord(LogRecordHeader &h, const uint8_t *payload)
+{
+    const uint16_t c = recordCrc(h, payload);
+    h.reserved[0] = kRecordSync;
+    std::memcpy(&h.reserved[1], &c, 2);
+}
+
+inline bool recordSealed(const LogRecordHeader &h) { return h.reserved[0] == kRecordSync; }
+
+// Nezapečetěný záznam (starý log) projde; zapečetěný jen se sedícím CRC.
+inline bool recordOk(const LogRecordHeader &h, const uint8_t *payload)
+{
+    if (!recordSealed(h)) return true;
+    uint16_t c;
+    std::memcpy(&c, &h.reserved[1], 2);
+    return c == recordCrc(h, payload);
+}
+
+// Věrohodná hlavička bloku; crc != nullptr (L2RAW03) = navíc CRC hlavičky.
+inline bool blockHeaderOk(const LogBlockHeader &bh, const LogBlockCrc *crc)
+{
+    if (!isBlockMagic(bh.magic) || bh.codec > kCodecZstd || bh.n_records == 0 ||
+        bh.raw_size > kMaxBlockRaw || bh.raw_size < uint64_t{bh.n_records} * sizeof(LogRecordHeader) ||
+        bh.stored_size > kMaxBlockRaw || bh.last_ts_ns < bh.first_ts_ns) {
+        return false;
+    }
+    return !crc || crc->header_crc == crc32c(&bh, sizeof(bh));
+}
+
+inline bool blockBodyOk(const LogBlockCrc &crc, const uint8_t *body, std::size_t size)
+{
+    return crc.body_crc == crc32c(body, size);
+}
+
+inline void putVarint(std::vector<uint8_t> &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+inline bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline uint32_t zigzag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+inline int32_t  unzigzag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1); }
+
+// cur XOR prev (n bajtů) jako běhy nul + literály.
+inline void putXorRuns(std::vector<uint8_t> &out, const uint8_t *cur, const uint8_t *prev, std::size_t n)
+{
+    std::size_t i = 0;
+    while (i < n) {
+        std::size_t z = i;
+        while (z < n && cur[z] == prev[z]) ++z;
+        std::size_t l = z;
+        // literály končí až dvěma shodnými bajty (jednotlivá shoda se nevyplatí)
+        while (l < n && !(cur[l] == prev[l] && (l + 1 >= n || cur[l + 1] == prev[l + 1]))) ++l;
+        putVarint(out, z - i);
+        putVarint(out, l - z);
+        for (std::size_t k = z; k < l; ++k) out.push_back(cur[k] ^ prev[k]);
+        i = l;
+    }
+}
+
+inline bool getXorRuns(const uint8_t *&p, const uint8_t *end, uint8_t *dst, const uint8_t *prev, std::size_t n)
+{
+    std::size_t i = 0;
+    while (i < n) {
+        uint64_t z = 0, l = 0;
+        if (!getVarint(p, end, z) || !getVarint(p, end, l)) return false;
+        if (z > n - i || l > n - i - z || l > static_cast<std::size_t>(end - p)) return false;
+        std::memcpy(dst + i, prev + i, z);
+        i += z;
+        for (uint64_t k = 0; k < l; ++k, ++i) dst[i] = *p++ ^ prev[i];
+    }
+    return true;
+}
+
+// Zigzag delta po sloupcích + bit-packing po skupinách kGroup.
+template <typename T>
+inline void putDeltaPacked(std::vector<uint8_t> &out, const T *v, int n)
+{
+    uint32_t z[kGroup];
+    int32_t last = 0;
+    for (int g = 0; g < n; g += kGroup) {
+        const int cnt = std::min(kGroup, n - g);
+        uint32_t any = 0;
+        for (int k = 0; k < cnt; ++k) {
+            const int32_t x = static_cast<int32_t>(v[g + k]);
+            z[k] = zigzag(x - last);
+            last = x;
+            any |= z[k];
+        }
+        const int width = any ? 32 - __builtin_clz(any) : 0;
+        out.push_back(static_cast<uint8_t>(width));
+        uint64_t acc = 0;
+        int bits = 0;
+        for (int k = 0; k < cnt && width; ++k) {
+            acc |= static_cast<uint64_t>(z[k]) << bits;
+            bits += width;
+            while (bits >= 8) {
+                out.push_back(static_cast<uint8_t>(acc));
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0) out.push_back(static_cast<uint8_t>(acc));
+    }
+}
+
+template <typename T>
+inline bool getDeltaPacked(const uint8_t *&p, const uint8_t *end, T *v, int n)
+{
+    int32_t last = 0;
+    for (int g = 0; g < n; g += kGroup) {
+        const int cnt = std::min(kGroup, n - g);
+        if (p >= end) return false;
+        const int width = *p++;
+        if (width > 32) return false;
+        const std::size_t bytes = (static_cast<std::size_t>(width) * cnt + 7) / 8;
+        if (bytes > static_cast<std::size_t>(end - p)) return false;
+        const uint64_t mask = width ? (~0ull >> (64 - width)) : 0;
+        uint64_t acc = 0;
+        int bits = 0;
+        for (int k = 0; k < cnt; ++k) {
+            while (bits < width) {
+                acc |= static_cast<uint64_t>(*p++) << bits;
+                bits += 8;
+            }
+            const uint32_t z = static_cast<uint32_t>(acc & mask);
+            acc = width ? acc >> width : acc;
+            bits -= width;
+            last += unzigzag(z);
+            v[g + k] = static_cast<T>(last);
+        }
+    }
+    return true;
+}
+
+} // namespace rawlog
+
+class RawLogBlockEncoder
+{
+public:
+    RawLogBlockEncoder()
+    {
+        packed_.reserve(1u << 20);
+        for (auto &p : prev_) p.reserve(rawlog::kMaxPayload);
+    }
+
+    // recs = proud záznamů L2RAW01 (LogRecordHeader + payload), celé záznamy.
+    // out = LogBlockHeader + LogBlockCrc + tělo (L2RAW03). false = poškozený vstup.
+    bool encode(const uint8_t *recs, std::size_t size, std::vector<uint8_t> &out)
+    {
+        using namespace rawlog;
+        LogBlockHeader bh{};
+        std::memcpy(bh.magic, kBlockMagic, 4);
+        bh.raw_size = static_cast<uint32_t>(size);
+
+        packed_.clear();
+        for (auto &p : prev_) p.clear();
+        uint64_t last_ts = 0;
+
+        std::size_t off = 0;
+        while (off + sizeof(LogRecordHeader) <= size) {
+            LogRecordHeader h;
+            std::memcpy(&h, recs + off, sizeof(h));
+            const uint8_t *payload = recs + off + sizeof(h);
+            if (h.payload_size > kMaxPayload || off + sizeof(h) + h.payload_size > size) return false;
+            off += sizeof(h) + h.payload_size;
+
+            if (bh.n_records == 0) {
+                bh.first_ts_ns = h.mono_ts_ns;
+                last_ts = h.mono_ts_ns;
+            }
+            bh.last_ts_ns = h.mono_ts_ns;
+            ++bh.n_records;
+
+            packed_.push_back(h.type);
+            putVarint(packed_, h.mono_ts_ns - last_ts);
+            putVarint(packed_, h.payload_size);
+            last_ts = h.mono_ts_ns;
+
+            std::vector<uint8_t> &prev = prev_[h.type & 3];
+            if (prev.size() < h.payload_size) prev.resize(h.payload_size, 0);
+
+            if (h.type == static_cast<uint8_t>(RawRecordType::Point) && h.payload_size == kPointSize) {
+                Packet pkt;
+                std::memcpy(&pkt, payload, sizeof(pkt));
+                if (bh.first_seq == 0) bh.first_seq = pkt.data.info.seq;
+                bh.last_seq = pkt.data.info.seq;
+
+                putXorRuns(packed_, payload, prev.data(), kRangesOff);
+                putXorRuns(packed_, payload + kRestOff, prev.data() + kRestOff, kPointSize - kRestOff);
+                putDeltaPacked(packed_, pkt.data.ranges, kPointCols);
+                putDeltaPacked(packed_, pkt.data.intensities, kPointCols);
+            } else {
+                putXorRuns(packed_, payload, prev.data(), h.payload_size);
+            }
+            std::memcpy(prev.data(), payload, h.payload_size);
+        }
+        if (off != size) return false;
+        bh.packed_size = static_cast<uint32_t>(packed_.size());
+
+        constexpr std::size_t hs = sizeof(LogBlockHeader) + sizeof(LogBlockCrc);
+        out.resize(hs);
+#if LIDAR_LOG_HAVE_ZSTD
+        const std::size_t bound = ZSTD_compressBound(packed_.size());
+        out.resize(hs + bound);
+        const std::size_t z = ZSTD_compress(out.data() + hs, bound,
+                                            packed_.data(), packed_.size(), kZstdLevel);
+        if (!ZSTD_isError(z) && z < packed_.size()) {
+            bh.codec = kCodecZstd;
+            out.resize(hs + z);
+        } else {
+            out.resize(hs);
+        }
+#endif
+        if (bh.codec == kCodecPacked) {
+            out.insert(out.end(), packed_.begin(), packed_.end());
+        }
+        bh.stored_size = static_cast<uint32_t>(out.size() - hs);
+        const LogBlockCrc crc{crc32c(&bh, sizeof(bh)), crc32c(out.data() + hs, bh.stored_size)};
+        std::memcpy(out.data(), &bh, sizeof(bh));
+        std::memcpy(out.data() + sizeof(bh), &crc, sizeof(crc));
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> packed_;
+    std::vector<uint8_t> prev_[4];   // poslední payload podle typu (type & 3)
+};
+
+// Tělo bloku → záznamy L2RAW01 (přidá na konec out). scratch = pracovní
+// buffer pro zstd. false = poškozený blok / nepodporovaný codec.
+inline bool decodeRawLogBlock(const LogBlockHeader &bh, const uint8_t *stored,
+                              std::vector<uint8_t> &out, std::vector<uint8_t> &scratch)
+{
+    using namespace rawlog;
+    const uint8_t *p = stored;
+    const uint8_t *end = stored + bh.stored_size;
+    if (bh.codec == kCodecZstd) {
+#if LIDAR_LOG_HAVE_ZSTD
+        scratch.resize(bh.packed_size);
+        const std::size_t z = ZSTD_decompress(scratch.data(), scratch.size(), stored, bh.stored_size);
+        if (ZSTD_isError(z) || z != bh.packed_size) return false;
+        p = scratch.data();
+        end = p + z;
+#else
+        (void)scratch;
+        return false;
+#endif
+    } else if (bh.codec != kCodecPacked) {
+        return false;
+    }
+
+    std::vector<uint8_t> prev[4];
+    uint64_t ts = bh.first_ts_ns;
+    const std::size_t base = out.size();
+    out.reserve(base + bh.raw_size);
+
+    for (uint32_t i = 0; i < bh.n_records; ++i) {
+        if (p >= end) return false;
+        LogRecordHeader h{};
+        h.type = *p++;
+        uint64_t dts = 0, size = 0;
+        if (!getVarint(p, end, dts) || !getVarint(p, end, size) || size > kMaxPayload) return false;
+        ts += dts;
+        h.mono_ts_ns = ts;
+        h.payload_size = static_cast<uint32_t>(size);
+
+        const std::size_t at = out.size();
+        out.resize(at + sizeof(h) + size);
+        std::memcpy(out.data() + at, &h, sizeof(h));
+        uint8_t *dst = out.data() + at + sizeof(h);
+
+        std::vector<uint8_t> &pv = prev[h.type & 3];
+        if (pv.size() < size) pv.resize(size, 0);
+
+        if (h.type == static_cast<uint8_t>(RawRecordType::Point) && size == kPointSize) {
+            Packet pkt;
+            if (!getXorRuns(p, end, dst, pv.data(), kRangesOff) ||
+                !getXorRuns(p, end, dst + kRestOff, pv.data() + kRestOff, kPointSize - kRestOff) ||
+                !getDeltaPacked(p, end, pkt.data.ranges, kPointCols) ||
+                !getDeltaPacked(p, end, pkt.data.intensities, kPointCols)) {
+                return false;
+            }
+            std::memcpy(dst + kRangesOff, pkt.data.ranges, sizeof(pkt.data.ranges));
+            std::memcpy(dst + kIntensOff, pkt.data.intensities, sizeof(pkt.data.intensities));
+        } else if (!getXorRuns(p, end, dst, pv.data(), size)) {
+            return false;
+        }
+        std::memcpy(pv.data(), dst, size);
+    }
+    return out.size() - base == bh.raw_size;
+}
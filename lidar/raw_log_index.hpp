@@ -0,0 +1,187 @@
+#pragma once
+
+// raw_log_index.hpp — řídký časový index syrového logu (sidecar .idx)
+// ---------------------------------------------------------------------------
+// • raw-HH-MM-SS.dat → raw-HH-MM-SS.idx: magic "L2IDX01\0", pak pole
+//   LogIndexEntry {mono_ts_ns, offset, seq} seřazené podle offsetu.
+//     L2RAW02/03: jeden záznam na blok (offset LogBlockHeader, ts a seq prvního
+//              záznamu bloku),
+//     L2RAW01: každý kIndexEvery-tý záznam (offset LogRecordHeader).
+// • Zapisovač (LidarRawLogger) index přidává po každé dávce, až po zápisu
+//   dat → index nikdy neukazuje za zapsaná data a po pádu zůstane platný
+//   prefix. Neúplný poslední záznam se při čtení ignoruje.
+// • Bez .idx (starý log, smazaný sidecar) se index postaví průchodem přes
+//   hlavičky (build) – jen hlavičky bloků / záznamů, payload se přeskočí.
+// • findTime / findSeq: binární hledání posledního záznamu indexu, který
+//   není za cílem → O(log n), zbytek do cíle dočte čtečka (max. jeden blok).
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "raw_log_format.hpp"
+
+#pragma pack(push, 1)
+struct LogIndexEntry
+{
+    uint64_t mono_ts_ns;     // první záznam bloku / indexovaný záznam
+    uint64_t offset;         // LogBlockHeader (v2, v3) / LogRecordHeader (v1)
+    uint32_t seq;            // info.seq prvního point paketu od offsetu (0 = není)
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LogIndexEntry) == 24, "LogIndexEntry must be packed as 24 bytes");
+
+class RawLogIndex
+{
+public:
+    static constexpr char     kMagic[8] = {'L','2','I','D','X','0','1','\0'};
+    static constexpr uint32_t kIndexEvery = 256;   // L2RAW01: záznamů na položku
+
+    std::vector<LogIndexEntry> entries;
+
+    // raw-HH-MM-SS.dat → raw-HH-MM-SS.idx
+    static std::string sidecarPath(const std::string &dat_path)
+    {
+        const std::size_t dot = dat_path.rfind('.');
+        const std::size_t slash = dat_path.rfind('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            return dat_path + ".idx";
+        }
+        return dat_path.substr(0, dot) + ".idx";
+    }
+
+    // Načtení sidecaru. data_size = velikost .dat (položky za ní se zahodí).
+    bool load(const std::string &idx_path, uint64_t data_size)
+    {
+        entries.clear();
+        const int fd = ::open(idx_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st{};
+        bool ok = ::fstat(fd, &st) == 0 && st.st_size >= 8;
+        char magic[8];
+        ok = ok && ::pread(fd, magic, 8, 0) == 8 && std::memcmp(magic, kMagic, 8) == 0;
+        if (ok) {
+            const std::size_t n = (static_cast<std::size_t>(st.st_size) - 8) / sizeof(LogIndexEntry);
+            entries.resize(n);
+            const ssize_t want = static_cast<ssize_t>(n * sizeof(LogIndexEntry));
+            ok = ::pread(fd, entries.data(), static_cast<std::size_t>(want), 8) == want;
+        }
+        ::close(fd);
+        if (!ok) {
+            entries.clear();
+            return false;
+        }
+        // seřazené podle offsetu, jen uvnitř zapsaných dat
+        std::size_t keep = 0;
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].offset >= data_size) break;
+            if (keep > 0 && entries[i].offset <= entries[keep - 1].offset) break;
+            entries[keep++] = entries[i];
+        }
+        entries.resize(keep);
+        return true;
+    }
+
+    // Uložení celého indexu (nástroje, obnova po pádu).
+    bool save(const std::string &idx_path) const
+    {
+        const int fd = ::open(idx_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        bool ok = ::write(fd, kMagic, 8) == 8;
+        const ssize_t want = static_cast<ssize_t>(entries.size() * sizeof(LogIndexEntry));
+        ok = ok && (want == 0 || ::write(fd, entries.data(), static_cast<std::size_t>(want)) == want);
+        return ::close(fd) == 0 && ok;
+    }
+
+    // Index průchodem přes hlavičky (fd = otevřený .dat).
+    bool build(int fd, uint64_t data_size)
+    {
+        entries.clear();
+        char magic[8];
+        if (data_size < 8 || ::pread(fd, magic, 8, 0) != 8) return false;
+        const int version = rawlog::magicVersion(magic);
+        if (version >= 2) {
+            // jen hlavičky (L2RAW03 i s CRC hlavičky), těla ověřuje čtečka
+            const std::size_t hs = rawlog::blockHeaderSize(version);
+            uint64_t off = 8;
+            struct { LogBlockHeader bh; LogBlockCrc crc; } h;
+            while (off + hs <= data_size &&
+                   ::pread(fd, &h, hs, static_cast<off_t>(off)) == static_cast<ssize_t>(hs) &&
+                   rawlog::blockHeaderOk(h.bh, version >= 3 ? &h.crc : nullptr) &&
+                   off + hs + h.bh.stored_size <= data_size) {
+                entries.push_back(LogIndexEntry{h.bh.first_ts_ns, off, h.bh.first_seq, 0});
+                off += hs + h.bh.stored_size;
+            }
+            return true;
+        }
+        if (rawlog::isMagicV1(magic)) {
+            uint64_t off = 8;
+            uint32_t count = 0;
+            LogRecordHeader h;
+            while (off + sizeof(h) <= data_size &&
+                   ::pread(fd, &h, sizeof(h), static_cast<off_t>(off)) == sizeof(h) &&
+                   h.payload_size <= rawlog::kMaxPayload &&
+                   off + sizeof(h) + h.payload_size <= data_size) {
+                if (count++ % kIndexEvery == 0) {
+                    entries.push_back(LogIndexEntry{h.mono_ts_ns, off, 0, 0});
+                }
+                if (!entries.empty() && entries.back().seq == 0) {
+                    entries.back().seq = pointSeq(fd, off, h);
+                }
+                off += sizeof(h) + h.payload_size;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Poslední položka s mono_ts_ns <= ts (jinak první). -1 = prázdný index.
+    long findTime(uint64_t ts) const
+    {
+        auto it = std::upper_bound(entries.begin(), entries.end(), ts,
+                                   [](uint64_t t, const LogIndexEntry &e) { return t < e.mono_ts_ns; });
+        return entries.empty() ? -1 : std::max(0L, static_cast<long>(it - entries.begin()) - 1);
+    }
+
+    // Poslední položka se seq <= seq (položky bez point paketu se přeskočí).
+    // seq je v rámci souboru monotónní, dokud LiDAR nerestartuje.
+    long findSeq(uint32_t seq) const
+    {
+        long lo = 0, hi = static_cast<long>(entries.size()) - 1, best = entries.empty() ? -1 : 0;
+        while (lo <= hi) {
+            const long mid = (lo + hi) / 2;
+            long m = mid;
+            while (m <= hi && entries[m].seq == 0) ++m;
+            if (m > hi) {
+                hi = mid - 1;
+            } else if (entries[m].seq <= seq) {
+                best = m;
+                lo = m + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return best;
+    }
+
+    // info.seq point paketu na offsetu (0 = jiný typ).
+    static uint32_t pointSeq(int fd, uint64_t off, const LogRecordHeader &h)
+    {
+        using Packet = unilidar_sdk2::LidarPointDataPacket;
+        uint32_t seq = 0;
+        if (h.type != static_cast<uint8_t>(RawRecordType::Point) || h.payload_size != sizeof(Packet)) {
+            return 0;
+        }
+        const off_t at = static_cast<off_t>(off + sizeof(h) + offsetof(Packet, data.info.seq));
+        return ::pread(fd, &seq, sizeof(seq), at) == sizeof(seq) ? seq : 0;
+    }
+};
@@ -0,0 +1,296 @@
+#pragma once
+
+// raw_log_mapped.hpp — čtení syrového logu přes mmap (offline nástroje)
+// ---------------------------------------------------------------------------
+// • RawLogMapped::open(): mmap celého .dat (PROT_READ), kontrola magicu
+//   L2RAW01 / 02 / 03, index ze sidecaru .idx nebo průchodem (RawLogIndex).
+// • Iterátor vrací RawLogView – hlavička + payload bez kopírování:
+//     L2RAW01: ukazatele přímo do mapované paměti,
+//     L2RAW02/03: blok se dekóduje do bufferu iterátoru (komprimovaná data
+//              zero-copy číst nejdou), view ukazuje do něj.
+//   Kontrolní součty (CRC bloku, zapečetěné záznamy) se ověřují, chyba =
+//   konec iterace s clean() == false.
+//   view.as<T>() = typovaný pohled na payload (nullptr, když nesedí typ,
+//   velikost nebo zarovnání – pak payload zkopírovat, viz copyTo).
+// • scanParallel(pool, fn): soubor se rozdělí na úseky podle položek
+//   indexu (hranice bloků / indexovaných záznamů), každý úsek projde jedno
+//   vlákno ParallelFor. fn(view, worker) se volá souběžně – pořadí platí
+//   jen uvnitř úseku.
+// ---------------------------------------------------------------------------
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parallel_for.hpp"
+#include "raw_log_format.hpp"
+#include "raw_log_index.hpp"
+
+struct RawLogView
+{
+    const LogRecordHeader *hdr = nullptr;
+    const uint8_t         *payload = nullptr;
+    uint64_t               offset = 0;   // záznam (v1) / blok (v2) v souboru
+
+    RawRecordType type() const { return static_cast<RawRecordType>(hdr->type); }
+    uint64_t monoTs() const { uint64_t t; std::memcpy(&t, &hdr->mono_ts_ns, sizeof(t)); return t; }
+    uint32_t size() const { uint32_t s; std::memcpy(&s, &hdr->payload_size, sizeof(s)); return s; }
+
+    // Typovaný pohled: jen když sedí typ záznamu, velikost a zarovnání.
+    template <typename T>
+    const T *as(RawRecordType t) const
+    {
+        if (type() != t || size() != sizeof(T) ||
+            reinterpret_cast<std::uintptr_t>(payload) % alignof(T) != 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T *>(payload);
+    }
+
+    const unilidar_sdk2::LidarPointDataPacket *point() const
+    {
+        return as<unilidar_sdk2::LidarPointDataPacket>(RawRecordType::Point);
+    }
+    const unilidar_sdk2::LidarImuDataPacket *imu() const
+    {
+        return as<unilidar_sdk2::LidarImuDataPacket>(RawRecordType::Imu);
+    }
+
+    // Kopie payloadu (nezarovnaný záznam); false = jiná velikost.
+    template <typename T>
+    bool copyTo(T &out) const
+    {
+        if (size() != sizeof(T)) return false;
+        std::memcpy(&out, payload, sizeof(T));
+        return true;
+    }
+};
+
+class RawLogMapped
+{
+public:
+    RawLogMapped() = default;
+    ~RawLogMapped() { close(); }
+
+    RawLogMapped(const RawLogMapped &) = delete;
+    RawLogMapped &operator=(const RawLogMapped &) = delete;
+
+    bool open(const std::string &path, std::string *err = nullptr)
+    {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        if (fd < 0 || ::fstat(fd, &st) != 0 || st.st_size < 8) {
+            if (err) *err = "cannot open " + path;
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        size_ = static_cast<uint64_t>(st.st_size);
+        void *m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            if (err) *err = "mmap failed: " + path;
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        base_ = static_cast<const uint8_t *>(m);
+        ::madvise(m, size_, MADV_SEQUENTIAL);
+
+        version_ = rawlog::magicVersion(base_);
+        if (version_ == 0) {
+            if (err) *err = "not a L2RAW log: " + path;
+            ::close(fd);
+            close();
+            return false;
+        }
+        if (!index_.load(RawLogIndex::sidecarPath(path), size_) || index_.entries.empty()) {
+            index_.build(fd, size_);
+        }
+        ::close(fd);   // mapování zůstává platné
+        return true;
+    }
+
+    void close()
+    {
+        if (base_) ::munmap(const_cast<uint8_t *>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+        version_ = 0;
+        index_.entries.clear();
+    }
+
+    int version() const { return version_; }
+    uint64_t size() const { return size_; }
+    const uint8_t *data() const { return base_; }
+    const RawLogIndex &index() const { return index_; }
+
+    // Vstupní iterátor přes záznamy v [offset, end_offset).
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = RawLogView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const RawLogView *;
+        using reference = const RawLogView &;
+
+        Iterator() = default;
+        Iterator(const RawLogMapped *log, uint64_t off, uint64_t end) : log_(log), off_(off), end_(end)
+        {
+            advance();
+        }
+
+        reference operator*() const { return view_; }
+        pointer operator->() const { return &view_; }
+        Iterator &operator++() { advance(); return *this; }
+
+        bool operator==(const Iterator &o) const
+        {
+            return done() == o.done() && (done() || (off_ == o.off_ && pos_ == o.pos_));
+        }
+        bool operator!=(const Iterator &o) const { return !(*this == o); }
+
+        // false = iterace skončila na poškozených datech (ne na konci úseku)
+        bool clean() const { return clean_; }
+
+    private:
+        bool done() const { return log_ == nullptr; }
+
+        void advance()
+        {
+            if (!log_) return;
+            if (log_->version_ >= 2) {
+                if (!block_ || pos_ >= block_->size()) {
+                    if (!nextBlock()) { log_ = nullptr; return; }
+                }
+                view_.hdr = reinterpret_cast<const LogRecordHeader *>(block_->data() + pos_);
+                view_.payload = block_->data() + pos_ + sizeof(LogRecordHeader);
+                view_.offset = block_off_;
+                pos_ += sizeof(LogRecordHeader) + view_.size();
+                return;
+            }
+            const uint8_t *p = log_->base_ + off_;
+            LogRecordHeader h;
+            if (off_ + sizeof(h) > end_) { finish(off_ == end_); return; }
+            std::memcpy(&h, p, sizeof(h));
+            if (h.payload_size > rawlog::kMaxPayload || off_ + sizeof(h) + h.payload_size > end_ ||
+                !rawlog::recordOk(h, p + sizeof(h))) {
+                finish(false);
+                return;
+            }
+            view_.hdr = reinterpret_cast<const LogRecordHeader *>(p);
+            view_.payload = p + sizeof(h);
+            view_.offset = off_;
+            off_ += sizeof(h) + h.payload_size;
+        }
+
+        bool nextBlock()
+        {
+            if (!block_) {
+                block_ = std::make_shared<std::vector<uint8_t>>();
+                scratch_ = std::make_shared<std::vector<uint8_t>>();
+            }
+            block_->clear();
+            pos_ = 0;
+            const std::size_t hs = rawlog::blockHeaderSize(log_->version_);
+            const bool crc = log_->version_ >= 3;
+            while (block_->empty()) {
+                LogBlockHeader bh;
+                LogBlockCrc    bc{};
+                if (off_ + hs > end_) { clean_ = off_ == end_; return false; }
+                std::memcpy(&bh, log_->base_ + off_, sizeof(bh));
+                if (crc) std::memcpy(&bc, log_->base_ + off_ + sizeof(bh), sizeof(bc));
+                const uint8_t *body = log_->base_ + off_ + hs;
+                if (!rawlog::blockHeaderOk(bh, crc ? &bc : nullptr) || off_ + hs + bh.stored_size > end_ ||
+                    (crc && !rawlog::blockBodyOk(bc, body, bh.stored_size)) ||
+                    !decodeRawLogBlock(bh, body, *block_, *scratch_)) {
+                    clean_ = false;
+                    return false;
+                }
+                block_off_ = off_;
+                off_ += hs + bh.stored_size;
+            }
+            return true;
+        }
+
+        void finish(bool clean)
+        {
+            clean_ = clean;
+            log_ = nullptr;
+        }
+
+        const RawLogMapped *log_ = nullptr;
+        uint64_t off_ = 0;
+        uint64_t end_ = 0;
+        RawLogView view_;
+        bool clean_ = true;
+
+        // jen L2RAW02/03
+        std::shared_ptr<std::vector<uint8_t>> block_;
+        std::shared_ptr<std::vector<uint8_t>> scratch_;
+        std::size_t pos_ = 0;
+        uint64_t block_off_ = 0;
+    };
+
+    Iterator begin() const { return base_ ? Iterator(this, 8, size_) : Iterator(); }
+    Iterator end() const { return Iterator(); }
+
+    // Od položky indexu, která není za ts (záznamy před ts si volající přeskočí).
+    Iterator fromTime(uint64_t ts) const
+    {
+        const long i = index_.findTime(ts);
+        return i < 0 ? begin() : Iterator(this, index_.entries[i].offset, size_);
+    }
+
+    // Paralelní průchod po úsecích indexu. Vrací počet záznamů; clean =
+    // false, když některý úsek skončil na poškozených datech.
+    template <typename Fn>
+    std::size_t scanParallel(ParallelFor &pool, Fn fn, bool *clean = nullptr) const
+    {
+        const auto &e = index_.entries;
+        if (!base_) return 0;
+        if (e.empty()) {
+            std::size_t n = 0;
+            Iterator it = begin();
+            for (; it != end(); ++it, ++n) fn(*it, 0);
+            if (clean) *clean = it.clean();
+            return n;
+        }
+
+        std::vector<std::size_t> counts(pool.threads(), 0);
+        std::vector<char> ok(pool.threads(), 1);
+        const int n_entries = static_cast<int>(e.size());
+        pool.run(n_entries, [&](int b, int end_i, int worker) {
+            const uint64_t from = b == 0 ? 8 : e[b].offset;
+            const uint64_t to = end_i >= n_entries ? size_ : e[end_i].offset;
+            Iterator it(this, from, to);
+            std::size_t n = 0;
+            for (; it != Iterator(); ++it, ++n) fn(*it, worker);
+            counts[worker] += n;
+            if (!it.clean()) ok[worker] = 0;
+        });
+
+        std::size_t total = 0;
+        bool all_ok = true;
+        for (unsigned i = 0; i < pool.threads(); ++i) {
+            total += counts[i];
+            all_ok = all_ok && ok[i];
+        }
+        if (clean) *clean = all_ok;
+        return total;
+    }
+
+private:
+    const uint8_t *base_ = nullptr;
+    uint64_t size_ = 0;
+    int version_ = 0;
+    RawLogIndex index_;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+// raw_log_reader.hpp — sekvenční čtení syrového logu s rychlým seekem
+// ---------------------------------------------------------------------------
+// • RawLogReader: otevře .dat (L2RAW01 / 02 / 03), načte sidecar .idx,
+//   chybí-li (nebo je prázdný), postaví index průchodem přes hlavičky.
+// • seekTime(ts) / seekSeq(seq): binární hledání v indexu (O(log n)) →
+//   skok na blok / indexovaný záznam, zbytek do cíle se přeskočí v next()
+//   (max. jeden blok, resp. kIndexEvery záznamů).
+// • next(rec): další záznam, payload je platný do dalšího volání. L2RAW02/03
+//   se dekóduje po blocích do interního bufferu. Kontrolní součty (CRC bloku
+//   L2RAW03, zapečetěné záznamy L2RAW01) se ověřují – chyba = konec čtení,
+//   zbytek zachrání lidar_raw_recover.
+// • Čte přes pread(), drží jen jeden blok / záznam v paměti.
+// ---------------------------------------------------------------------------
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "raw_log_format.hpp"
+#include "raw_log_index.hpp"
+
+struct RawLogRecord
+{
+    LogRecordHeader hdr;
+    const uint8_t  *payload;   // hdr.payload_size bajtů
+};
+
+class RawLogReader
+{
+public:
+    RawLogReader() = default;
+    ~RawLogReader() { close(); }
+
+    RawLogReader(const RawLogReader &) = delete;
+    RawLogReader &operator=(const RawLogReader &) = delete;
+
+    // false = soubor nejde otevřít / neznámý magic (err = důvod).
+    bool open(const std::string &path, std::string *err = nullptr)
+    {
+        close();
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        if (fd_ < 0 || ::fstat(fd_, &st) != 0) {
+            if (err) *err = "cannot open " + path;
+            close();
+            return false;
+        }
+        size_ = static_cast<uint64_t>(st.st_size);
+        char magic[8];
+        if (size_ < 8 || ::pread(fd_, magic, 8, 0) != 8 || rawlog::magicVersion(magic) == 0) {
+            if (err) *err = "not a L2RAW log: " + path;
+            close();
+            return false;
+        }
+        version_ = rawlog::magicVersion(magic);
+        if (!index_.load(RawLogIndex::sidecarPath(path), size_) || index_.entries.empty()) {
+            index_.build(fd_, size_);
+        }
+        rewind();
+        return true;
+    }
+
+    void close()
+    {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        size_ = 0;
+        version_ = 0;
+        index_.entries.clear();
+        block_.clear();
+    }
+
+    int version() const { return version_; }
+    uint64_t size() const { return size_; }
+    const RawLogIndex &index() const { return index_; }
+
+    void rewind() { position(8); }
+
+    // Na první záznam s mono_ts_ns >= ts.
+    bool seekTime(uint64_t ts)
+    {
+        const long i = index_.findTime(ts);
+        if (i < 0) return false;
+        position(index_.entries[i].offset);
+        skip_ts_ = ts;
+        return true;
+    }
+
+    // Na první point paket s info.seq >= seq.
+    bool seekSeq(uint32_t seq)
+    {
+        const long i = index_.findSeq(seq);
+        if (i < 0) return false;
+        position(index_.entries[i].offset);
+        skip_seq_ = seq;
+        skip_by_seq_ = true;
+        return true;
+    }
+
+    // Další záznam; false = konec souboru nebo poškozená data.
+    bool next(RawLogRecord &rec)
+    {
+        while (read(rec)) {
+            if (rec.hdr.mono_ts_ns < skip_ts_) continue;
+            if (skip_by_seq_) {
+                if (!isPoint(rec) || seqOf(rec) < skip_seq_) continue;
+                skip_by_seq_ = false;
+            }
+            skip_ts_ = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // Offset v souboru, odkud se bude číst dál (hranice bloku u L2RAW02).
+    uint64_t offset() const { return off_; }
+
+    static bool isPoint(const RawLogRecord &r)
+    {
+        return r.hdr.type == static_cast<uint8_t>(RawRecordType::Point) &&
+               r.hdr.payload_size == sizeof(unilidar_sdk2::LidarPointDataPacket);
+    }
+
+    static uint32_t seqOf(const RawLogRecord &r)
+    {
+        uint32_t seq = 0;
+        std::memcpy(&seq, r.payload + offsetof(unilidar_sdk2::LidarPointDataPacket, data.info.seq),
+                    sizeof(seq));
+        return seq;
+    }
+
+private:
+    void position(uint64_t off)
+    {
+        off_ = off;
+        block_.clear();
+        block_pos_ = 0;
+        skip_ts_ = 0;
+        skip_by_seq_ = false;
+    }
+
+    bool read(RawLogRecord &rec)
+    {
+        if (version_ >= 2) {
+            if (block_pos_ >= block_.size() && !readBlock()) return false;
+            std::memcpy(&rec.hdr, block_.data() + block_pos_, sizeof(rec.hdr));
+            rec.payload = block_.data() + block_pos_ + sizeof(rec.hdr);
+            block_pos_ += sizeof(rec.hdr) + rec.hdr.payload_size;
+            return true;
+        }
+        if (off_ + sizeof(rec.hdr) > size_ ||
+            ::pread(fd_, &rec.hdr, sizeof(rec.hdr), static_cast<off_t>(off_)) != sizeof(rec.hdr) ||
+            rec.hdr.payload_size > rawlog::kMaxPayload ||
+            off_ + sizeof(rec.hdr) + rec.hdr.payload_size > size_) {
+            return false;
+        }
+        block_.resize(rec.hdr.payload_size);
+        if (::pread(fd_, block_.data(), block_.size(), static_cast<off_t>(off_ + sizeof(rec.hdr))) !=
+                static_cast<ssize_t>(block_.size()) ||
+            !rawlog::recordOk(rec.hdr, block_.data())) {
+            return false;
+        }
+        rec.payload = block_.data();
+        off_ += sizeof(rec.hdr) + rec.hdr.payload_size;
+        return true;
+    }
+
+    // Další neprázdný blok L2RAW02/03 do block_.
+    bool readBlock()
+    {
+        const std::size_t hs = rawlog::blockHeaderSize(version_);
+        const bool crc = version_ >= 3;
+        struct { LogBlockHeader bh; LogBlockCrc crc; } h;
+        block_.clear();
+        block_pos_ = 0;
+        while (block_.empty()) {
+            if (off_ + hs > size_ ||
+                ::pread(fd_, &h, hs, static_cast<off_t>(off_)) != static_cast<ssize_t>(hs) ||
+                !rawlog::blockHeaderOk(h.bh, crc ? &h.crc : nullptr) ||
+                off_ + hs + h.bh.stored_size > size_) {
+                return false;
+            }
+            stored_.resize(h.bh.stored_size);
+            if (::pread(fd_, stored_.data(), stored_.size(), static_cast<off_t>(off_ + hs)) !=
+                    static_cast<ssize_t>(stored_.size()) ||
+                (crc && !rawlog::blockBodyOk(h.crc, stored_.data(), stored_.size())) ||
+                !decodeRawLogBlock(h.bh, stored_.data(), block_, scratch_)) {
+                block_.clear();
+                return false;
+            }
+            off_ += hs + h.bh.stored_size;
+        }
+        return true;
+    }
+
+    int      fd_ = -1;
+    uint64_t size_ = 0;
+    int      version_ = 0;
+    RawLogIndex index_;
+
+    uint64_t off_ = 8;
+    std::vector<uint8_t> block_;     // L2RAW02/03: dekódovaný blok, L2RAW01: payload
+    std::size_t          block_pos_ = 0;
+    std::vector<uint8_t> stored_;
+    std::vector<uint8_t> scratch_;
+
+    uint64_t skip_ts_ = 0;
+    uint32_t skip_seq_ = 0;
+    bool     skip_by_seq_ = false;
+};
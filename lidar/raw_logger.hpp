@@ -1,81 +1,184 @@
 #pragma once
 
-#include <cstdint>
-#include <string>
-#include <fstream>
+// raw_logger.hpp — záznam syrových paketů LiDARu (L2RAW03, příp. L2RAW01)
+// ---------------------------------------------------------------------------
+// • Formát viz raw_log_format.hpp. Výchozí je L2RAW03 (bloky s delta /
+//   bit-packingem, volitelně zstd, CRC32C hlavičky a těla), compress = false
+//   zapisuje L2RAW01 se zapečetěnými záznamy (sync značka + CRC16).
+// • Zápis je asynchronní: loopRead() jen zkopíruje záznam do aktivního
+//   předalokovaného bufferu (memcpy pod krátkým zámkem). Plný buffer, nebo
+//   buffer starší než kFlushIntervalNs, se předá vláknu zapisovače (stáří
+//   hlídá i zapisovač sám na časovač – když pakety přestanou chodit, data
+//   v RAM nezůstanou; mono_ts_ns = steady_clock), které
+//   každý buffer zakóduje jako jeden blok a všechny čekající zapíše jedním
+//   writev() – velké sekvenční bloky, zaseknutí SD karty ani komprese se na
+//   ingest nepropisuje.
+// • Buffery jsou v poolu (kBuffers × kBufferBytes). Když zapisovač nestíhá
+//   a volný buffer není, záznam se zahodí (dropped) – loopRead nikdy nečeká
+//   na disk.
+// • Rotace: max_file_bytes / max_file_ns (0 = bez limitu) – při překročení
+//   zapisovač před další dávkou zavře soubor a otevře nový raw-HH-MM-SS.dat
+//   (+ .idx; další soubor ve stejné sekundě raw-HH-MM-SS-<n>.dat). Ingest
+//   vlákno o rotaci neví. Když se soubor otevřít nepodaří,
+//   dávky se zahazují a otevření se zkouší znovu u každé další dávky.
+// • setEnabled(): zap/vyp bez rušení loggeru (vlákno, buffery zůstávají).
+//   Volající jen předá rozpracovaný buffer a nastaví příznak; soubor zavře
+//   zapisovač po zápisu poslední dávky a další zapnutí otevře nový soubor
+//   – ingest ani TCP vlákno nikdy nečeká na disk.
+// • Vedle .dat se průběžně zapisuje řídký časový index .idx (viz
+//   raw_log_index.hpp) – po každé dávce, až po datech.
+// • writeRawLogFile(): celý proud záznamů najednou do nového L2RAW03 + .idx
+//   (black box, offline nástroje) – bloky po kBufferBytes, na konci fsync.
+// • RawLoggerStats: append (cena kopie na ingest vlákně), encode (items =
+//   vstupní bajty), write (doba writev, items = bajty), raw_bytes / bytes /
+//   records / dropped. TCP STATS.
+// ---------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>   // C++17
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <sstream>
-#include <filesystem>   // C++17
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "unitree_lidar_protocol.h"  // LidarPointDataPacket, LidarImuDataPacket, LidarVersionDataPacket
+#include "raw_log_format.hpp"
+#include "raw_log_index.hpp"
+#include "stage_stats.hpp"
 
 // Pokud by std::filesystem dělal problémy (starší g++), můžeš
 // implementaci makeDefaultPath() přepsat na POSIX mkdir.
 
-enum class RawRecordType : uint8_t {
-    Point   = 1,
-    Imu     = 2,
-    Version = 3,
-};
-
-#pragma pack(push, 1)
-struct LogRecordHeader
+struct RawLoggerStats
 {
-    uint8_t  type;           // viz RawRecordType
-    uint8_t  reserved[3];    // zarovnání / future use
-    uint64_t mono_ts_ns;     // monotonic timestamp hosta v ns
-    uint32_t payload_size;   // velikost payloadu v bajtech (mělo by odpovídat header.packet_size)
-};
-#pragma pack(pop)
+    StageStats append;                        // ingest vlákno: kopie do bufferu
+    StageStats encode;                        // zapisovač: kódování bloku (items = bajty)
+    StageStats write;                         // zapisovač: writev (items = bajty)
+    std::atomic<std::uint64_t> records{0};
+    std::atomic<std::uint64_t> raw_bytes{0};  // záznamy ve tvaru L2RAW01
+    std::atomic<std::uint64_t> bytes{0};      // zapsáno na disk
+    std::atomic<std::uint64_t> dropped{0};    // záznamy zahozené pro plné buffery
+    std::atomic<std::uint64_t> errors{0};     // chyby write
+    std::atomic<std::uint64_t> files{0};      // otevřené soubory (rotace)
 
-static_assert(sizeof(LogRecordHeader) == 1 + 3 + 8 + 4,
-              "LogRecordHeader must be packed as 16 bytes");
+    std::string toString(const char *name) const
+    {
+        std::ostringstream os;
+        os << name
+           << " records=" << records.load(std::memory_order_relaxed)
+           << " raw_bytes=" << raw_bytes.load(std::memory_order_relaxed)
+           << " bytes=" << bytes.load(std::memory_order_relaxed)
+           << " dropped=" << dropped.load(std::memory_order_relaxed)
+           << " errors=" << errors.load(std::memory_order_relaxed)
+           << " files=" << files.load(std::memory_order_relaxed);
+        const std::string n(name);
+        return os.str() + " | " + append.toString((n + "_append").c_str()) +
+               " | " + encode.toString((n + "_encode").c_str()) +
+               " | " + write.toString((n + "_write").c_str());
+    }
+};
 
 class LidarRawLogger
 {
 public:
+    static constexpr std::size_t   kBuffers = 4;
+    static constexpr std::size_t   kBufferBytes = 1u << 20;              // ~4,5 s point paketů
+    static constexpr std::uint64_t kFlushIntervalNs = 1000000000ull;     // max. stáří dat v RAM
+
     /// Vytvoří logger a otevře nové logovací soubory.
     /// base_dir: root pro logy, defaultně "/data/robot/lidar".
-    explicit LidarRawLogger(const std::string& base_dir = "/data/robot/lidar")
+    /// stats: kam počítat statistiky (nullptr = interní).
+    /// compress: L2RAW03 (bloky), jinak L2RAW01.
+    /// max_file_bytes / max_file_ns: rotace souboru (0 = bez limitu).
+    /// enabled: false = soubor se otevře až s prvními daty po setEnabled(true).
+    explicit LidarRawLogger(const std::string& base_dir = "/data/robot/lidar",
+                            RawLoggerStats* stats = nullptr,
+                            bool compress = true,
+                            uint64_t max_file_bytes = 0,
+                            uint64_t max_file_ns = 0,
+                            bool enabled = true)
+        : base_dir_(base_dir), stats_(stats ? stats : &own_stats_), compress_(compress),
+          max_file_bytes_(max_file_bytes), max_file_ns_(max_file_ns), enabled_(enabled)
     {
-        path_ = makeDefaultPath(base_dir);
-        openStream();
+        if (enabled) {
+            path_ = name_base_ = makeDefaultPath(base_dir);
+            if (!openStream()) {
+                // Tady se dá místo výjimky jen nastavit "logging disabled".
+                throw std::runtime_error("LidarRawLogger: failed to open log file: " + path_);
+            }
+        }
+
+        free_.reserve(kBuffers);
+        full_.reserve(kBuffers);
+        for (std::size_t i = 0; i < kBuffers; ++i) {
+            bufs_[i].data.reset(new uint8_t[kBufferBytes]);
+            std::memset(bufs_[i].data.get(), 0, kBufferBytes);   // page faulty teď, ne v loopRead
+            free_.push_back(i);
+        }
+        worker_ = std::thread(&LidarRawLogger::loop, this);
     }
 
     ~LidarRawLogger()
     {
-        if (ofs_.is_open()) {
-            ofs_.flush();
-            ofs_.close();
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            handOff();
+            stop_ = true;
         }
+        cv_.notify_one();
+        if (worker_.joinable()) worker_.join();
+        closeStream();
     }
 
-    // nekopírovatelné
+    // nekopírovatelné ani nepřesouvatelné (vlákno drží this)
     LidarRawLogger(const LidarRawLogger&) = delete;
     LidarRawLogger& operator=(const LidarRawLogger&) = delete;
 
-    // přesun povolený (když bys chtěl)
-    LidarRawLogger(LidarRawLogger&& other) noexcept
-        : ofs_(std::move(other.ofs_))
-        , path_(std::move(other.path_))
-    {}
+    bool isOpen() const noexcept { return open_.load(std::memory_order_relaxed); }
 
-    LidarRawLogger& operator=(LidarRawLogger&& other) noexcept
+    /// Zap/vyp záznamu (libovolné vlákno, neblokuje na disku). Vypnutí předá
+    /// rozpracovaný buffer zapisovači, který po jeho zápisu zavře soubor.
+    void setEnabled(bool on)
     {
-        if (this != &other) {
-            if (ofs_.is_open()) {
-                ofs_.close();
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            if (on == enabled_) return;
+            enabled_ = on;
+            if (!on) {
+                handOff();
+                close_req_ = true;
             }
-            ofs_  = std::move(other.ofs_);
-            path_ = std::move(other.path_);
         }
-        return *this;
+        cv_.notify_one();
+    }
+
+    bool enabled() const
+    {
+        std::lock_guard<std::mutex> lg(mtx_);
+        return enabled_;
     }
 
-    bool isOpen() const noexcept { return ofs_.is_open(); }
-    const std::string& path() const noexcept { return path_; }
+    std::string path() const
+    {
+        std::lock_guard<std::mutex> lg(path_mtx_);
+        return path_;
+    }
+    std::string indexPath() const { return RawLogIndex::sidecarPath(path()); }
+    const RawLoggerStats& stats() const noexcept { return *stats_; }
 
     /// Zápis 3D point packetu
     void writePointPacket(const unilidar_sdk2::LidarPointDataPacket& pkt,
@@ -110,11 +213,9 @@ public:
                        mono_ts_ns);
     }
 
-private:
-    std::ofstream ofs_;
-    std::string   path_;
-
-    static std::string makeDefaultPath(const std::string& base_dir)
+    /// <base_dir>/<YYYY-MM-DD>/<prefix>HH-MM-SS.dat (adresář se vytvoří).
+    static std::string makeDefaultPath(const std::string& base_dir,
+                                       const char* prefix = "raw-")
     {
         namespace fs = std::filesystem;
 
@@ -134,24 +235,124 @@ private:
         fs::create_directories(date_dir_path);
 
         std::ostringstream file_ss;
-        file_ss << "raw-" << std::put_time(&tm, "%H-%M-%S") << ".dat";
+        file_ss << prefix << std::put_time(&tm, "%H-%M-%S") << ".dat";
 
         fs::path file_path = date_dir_path / file_ss.str();
         return file_path.string();
     }
 
-    void openStream()
+private:
+    struct Buffer {
+        std::unique_ptr<uint8_t[]> data;
+        std::size_t                size = 0;
+    };
+
+    int            fd_ = -1;                  // po konstrukci jen zapisovač (rotace, zap/vyp)
+    int            idx_fd_ = -1;              // sidecar .idx (-1 = bez indexu)
+    std::atomic<bool> open_{false};
+    uint64_t       file_off_ = 0;             // konec zapsaných dat (jen zapisovač)
+    uint64_t       file_t0_ = 0;              // mono_ts_ns první dávky souboru
+    uint64_t       indexed_records_ = 0;      // L2RAW01: počítadlo pro kIndexEvery
+    std::vector<LogIndexEntry> index_batch_;
+    std::string    base_dir_;
+    std::string    path_;
+    mutable std::mutex path_mtx_;             // path_ mění zapisovač při rotaci
+    std::string    name_base_;                // makeDefaultPath() posledního souboru
+    unsigned       name_seq_ = 0;             // přípona -<n> v téže sekundě
+    RawLoggerStats own_stats_;
+    RawLoggerStats* stats_;
+    bool           compress_;
+    uint64_t       max_file_bytes_;
+    uint64_t       max_file_ns_;
+    RawLogBlockEncoder encoder_;                            // jen vlákno zapisovače
+    std::array<std::vector<uint8_t>, kBuffers> blocks_;     // zakódované bloky dávky
+
+    std::array<Buffer, kBuffers> bufs_;
+    std::vector<std::size_t> free_;       // volné buffery
+    std::vector<std::size_t> full_;       // čekají na zápis (v pořadí)
+    long          active_ = -1;           // plněný buffer, -1 = žádný
+    std::uint64_t active_t0_ = 0;         // mono_ts_ns prvního záznamu v aktivním
+    bool          enabled_;               // záznam zapnutý (setEnabled)
+    bool          close_req_ = false;     // vypnuto: po zápisu dávky zavřít soubor
+    bool          stop_ = false;
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::thread             worker_;
+
+    // Otevře path_ (+ .idx) a zapíše magic. false = soubor nejde otevřít.
+    bool openStream()
+    {
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        open_.store(fd_ >= 0, std::memory_order_relaxed);
+        if (fd_ < 0) {
+            return false;
+        }
+        stats_->files.fetch_add(1, std::memory_order_relaxed);
+
+        // souborová hlavička s "magic" a verzí formátu
+        const char *magic = compress_ ? rawlog::kMagicV3 : rawlog::kMagicV1;
+        struct iovec iov{const_cast<char*>(magic), 8};
+        writeAll(&iov, 1);
+        file_off_ = 8;
+
+        // index je jen zrychlení – bez něj se log dá číst (RawLogIndex::build)
+        idx_fd_ = ::open(RawLogIndex::sidecarPath(path_).c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (idx_fd_ >= 0 && ::write(idx_fd_, RawLogIndex::kMagic, 8) != 8) {
+            ::close(idx_fd_);
+            idx_fd_ = -1;
+        }
+        return true;
+    }
+
+    void closeStream()
     {
-        ofs_.open(path_, std::ios::out | std::ios::binary);
-        if (!ofs_) {
-            // Tady se dá místo výjimky jen nastavit "logging disabled".
-            throw std::runtime_error("LidarRawLogger: failed to open log file: " + path_);
+        if (fd_ >= 0) ::close(fd_);
+        if (idx_fd_ >= 0) ::close(idx_fd_);
+        fd_ = idx_fd_ = -1;
+        open_.store(false, std::memory_order_relaxed);
+    }
+
+    // Rotace před dávkou začínající v ts (jen zapisovač). Zavřený soubor (po
+    // vypnutí nebo nepovedeném otevření) se otevírá znovu u každé dávky.
+    // false = soubor není otevřený, dávka se zahodí.
+    bool rotateIfDue(uint64_t ts)
+    {
+        if (fd_ >= 0) {
+            if (file_t0_ == 0) file_t0_ = ts;
+            const bool due = (max_file_bytes_ > 0 && file_off_ >= max_file_bytes_) ||
+                             (max_file_ns_ > 0 && ts - file_t0_ >= max_file_ns_);
+            if (!due) return true;
+        }
+
+        std::string next;
+        try {
+            next = makeDefaultPath(base_dir_);
+        } catch (const std::exception &) {
+            stats_->errors.fetch_add(1, std::memory_order_relaxed);
+            return fd_ >= 0;
+        }
+        // stejná sekunda (zap/vyp, rychlá rotace) – O_TRUNC by přepsal soubor
+        if (next == name_base_) {
+            next = next.substr(0, next.size() - 4) + '-' + std::to_string(++name_seq_) + ".dat";
+        } else {
+            name_base_ = next;
+            name_seq_ = 0;
         }
 
-        // (volitelné) souborová hlavička s "magic" a verzí formátu
-        // Můžeš vynechat, jestli nechceš globální header.
-        const char magic[8] = {'L','2','R','A','W','0','1','\0'};
-        ofs_.write(magic, sizeof(magic));
+        closeStream();
+        {
+            std::lock_guard<std::mutex> lg(path_mtx_);
+            path_ = next;
+        }
+        file_off_ = 0;
+        file_t0_ = ts;
+        indexed_records_ = 0;
+        if (!openStream()) {
+            stats_->errors.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
     }
 
     void writeAnyPacket(RawRecordType type,
@@ -160,10 +361,6 @@ private:
                         size_t   packet_object_size,
                         uint64_t mono_ts_ns)
     {
-        if (!ofs_.is_open()) {
-            return; // logging vypnutý / neotevřený soubor
-        }
-
         // Bezpečnostní kontrola: lidar tvrdí, kolik má mít packet bajtů.
         // Nemělo by nikdy přesáhnout velikost objektu v paměti.
         if (packet_size_field == 0 || packet_size_field > packet_object_size) {
@@ -171,13 +368,272 @@ private:
             return;
         }
 
+        StageTimer timer(stats_->append, 1);
+
         LogRecordHeader hdr{};
         hdr.type         = static_cast<uint8_t>(type);
         hdr.mono_ts_ns   = mono_ts_ns;
         hdr.payload_size = packet_size_field;
+        const std::size_t rec = sizeof(hdr) + packet_size_field;
+
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            if (!enabled_) return;   // záznam vypnutý
+            if (active_ >= 0 &&
+                (bufs_[active_].size + rec > kBufferBytes ||
+                 mono_ts_ns - active_t0_ > kFlushIntervalNs)) {
+                handOff();
+                notify = true;
+            }
+            if (active_ < 0) {
+                if (free_.empty()) {
+                    stats_->dropped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    active_ = static_cast<long>(free_.back());
+                    free_.pop_back();
+                    active_t0_ = mono_ts_ns;
+                }
+            }
+            if (active_ >= 0) {
+                Buffer &b = bufs_[active_];
+                std::memcpy(b.data.get() + b.size, &hdr, sizeof(hdr));
+                std::memcpy(b.data.get() + b.size + sizeof(hdr), pkt_data, packet_size_field);
+                b.size += rec;
+                stats_->records.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (notify) cv_.notify_one();
+    }
+
+    static std::uint64_t monotonicNs()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Aktivní buffer → fronta k zápisu (pod mtx_).
+    void handOff()
+    {
+        if (active_ < 0) return;
+        if (bufs_[active_].size > 0) {
+            full_.push_back(static_cast<std::size_t>(active_));
+        } else {
+            free_.push_back(static_cast<std::size_t>(active_));
+        }
+        active_ = -1;
+    }
+
+    // Vlákno zapisovače: kódování bloků, všechny čekající buffery jedním writev().
+    void loop()
+    {
+        std::array<std::size_t, kBuffers> batch{};
+        std::array<struct iovec, kBuffers> iov{};
+        std::unique_lock<std::mutex> lk(mtx_);
+        for (;;) {
+            cv_.wait_for(lk, std::chrono::nanoseconds(kFlushIntervalNs / 2),
+                         [this] { return stop_ || close_req_ || !full_.empty(); });
+            // pakety nechodí (porucha, kabel): stárnoucí buffer předá zapisovač
+            const std::uint64_t now = monotonicNs();
+            if (full_.empty() && active_ >= 0 && now > active_t0_ + kFlushIntervalNs) {
+                handOff();
+            }
+            if (full_.empty() && !close_req_) {
+                if (stop_) break;   // vše zapsáno
+                continue;
+            }
+
+            const bool close = close_req_;
+            close_req_ = false;
+            const std::size_t n = full_.size();
+            for (std::size_t i = 0; i < n; ++i) {
+                batch[i] = full_[i];
+                iov[i].iov_base = bufs_[batch[i]].data.get();
+                iov[i].iov_len  = bufs_[batch[i]].size;
+            }
+            full_.clear();
+            lk.unlock();
+
+            if (n > 0) {
+                LogRecordHeader first;
+                std::memcpy(&first, iov[0].iov_base, sizeof(first));
+                if (rotateIfDue(first.mono_ts_ns)) {
+                    writeBatch(iov.data(), n);
+                }
+            }
+            if (close) closeStream();   // vypnuto: další zapnutí = nový soubor
+
+            lk.lock();
+            for (std::size_t i = 0; i < n; ++i) {
+                bufs_[batch[i]].size = 0;
+                free_.push_back(batch[i]);
+            }
+        }
+    }
+
+    // Dávka bufferů → bloky (L2RAW03) / zapečetěné záznamy (L2RAW01), jeden
+    // writev() a index za ní (jen zapisovač, soubor je otevřený).
+    void writeBatch(struct iovec *iov, std::size_t n)
+    {
+        std::size_t raw = 0;
+        for (std::size_t i = 0; i < n; ++i) raw += iov[i].iov_len;
+        stats_->raw_bytes.fetch_add(raw, std::memory_order_relaxed);
+        if (compress_) {
+            StageTimer timer(stats_->encode, raw);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!encoder_.encode(static_cast<const uint8_t*>(iov[i].iov_base),
+                                     iov[i].iov_len, blocks_[i])) {
+                    blocks_[i].clear();   // nemůže nastat: buffer má jen celé záznamy
+                    stats_->errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                iov[i].iov_base = blocks_[i].data();
+                iov[i].iov_len  = blocks_[i].size();
+            }
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                sealBuffer(static_cast<uint8_t*>(iov[i].iov_base), iov[i].iov_len);
+            }
+        }
+
+        std::size_t bytes = 0;
+        index_batch_.clear();
+        for (std::size_t i = 0; i < n; ++i) {
+            indexBuffer(static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len,
+                        file_off_ + bytes);
+            bytes += iov[i].iov_len;
+        }
+        StageTimer timer(stats_->write, bytes);
+        if (writeAll(iov, static_cast<int>(n))) {
+            stats_->bytes.fetch_add(bytes, std::memory_order_relaxed);
+            file_off_ += bytes;
+            appendIndex();
+        } else {
+            const off_t end = ::lseek(fd_, 0, SEEK_CUR);
+            file_off_ = end > 0 ? static_cast<uint64_t>(end) : file_off_;
+        }
+    }
+
+    // Položky indexu pro jeden zapisovaný buffer / blok na offsetu off.
+    void indexBuffer(const uint8_t *data, std::size_t size, uint64_t off)
+    {
+        if (idx_fd_ < 0 || size == 0) return;
+        if (compress_) {
+            LogBlockHeader bh;
+            std::memcpy(&bh, data, sizeof(bh));
+            index_batch_.push_back(LogIndexEntry{bh.first_ts_ns, off, bh.first_seq, 0});
+            return;
+        }
+        using Packet = unilidar_sdk2::LidarPointDataPacket;
+        for (std::size_t at = 0; at + sizeof(LogRecordHeader) <= size;) {
+            LogRecordHeader h;
+            std::memcpy(&h, data + at, sizeof(h));
+            if (indexed_records_++ % RawLogIndex::kIndexEvery == 0) {
+                index_batch_.push_back(LogIndexEntry{h.mono_ts_ns, off + at, 0, 0});
+            }
+            if (!index_batch_.empty() && index_batch_.back().seq == 0 &&
+                h.type == static_cast<uint8_t>(RawRecordType::Point) && h.payload_size == sizeof(Packet)) {
+                std::memcpy(&index_batch_.back().seq,
+                            data + at + sizeof(h) + offsetof(Packet, data.info.seq), sizeof(uint32_t));
+            }
+            at += sizeof(h) + h.payload_size;
+        }
+    }
+
+    // L2RAW01: sync značka + CRC do každého záznamu bufferu (zapisovač).
+    static void sealBuffer(uint8_t *data, std::size_t size)
+    {
+        for (std::size_t at = 0; at + sizeof(LogRecordHeader) <= size;) {
+            LogRecordHeader h;
+            std::memcpy(&h, data + at, sizeof(h));
+            rawlog::sealRecord(h, data + at + sizeof(h));
+            std::memcpy(data + at, &h, sizeof(h));
+            at += sizeof(h) + h.payload_size;
+        }
+    }
+
+    void appendIndex()
+    {
+        if (idx_fd_ < 0 || index_batch_.empty()) return;
+        const std::size_t want = index_batch_.size() * sizeof(LogIndexEntry);
+        if (::write(idx_fd_, index_batch_.data(), want) != static_cast<ssize_t>(want)) {
+            stats_->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 
-        ofs_.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
-        ofs_.write(reinterpret_cast<const char*>(pkt_data),
-                   static_cast<std::streamsize>(packet_size_field));
+    // writev s dopsáním po částečném zápisu. false = chyba (data zahozena).
+    bool writeAll(struct iovec *iov, int cnt)
+    {
+        while (cnt > 0) {
+            const ssize_t w = ::writev(fd_, iov, cnt);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                stats_->errors.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::size_t left = static_cast<std::size_t>(w);
+            while (cnt > 0 && left >= iov->iov_len) {
+                left -= iov->iov_len;
+                ++iov;
+                --cnt;
+            }
+            if (cnt > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + left;
+                iov->iov_len -= left;
+            }
+        }
+        return true;
     }
 };
+
+// Proud záznamů L2RAW01 (celé záznamy) → nový soubor L2RAW03 se sidecarem
+// .idx. Bloky se řežou na hranicích záznamů po max. kBufferBytes vstupu,
+// stejně jako v LidarRawLogger. Blokující (volat mimo loopRead).
+inline bool writeRawLogFile(const std::string& path, const uint8_t* recs, std::size_t size,
+                            std::string* err = nullptr)
+{
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        if (err) *err = "cannot open " + path;
+        return false;
+    }
+    RawLogBlockEncoder encoder;
+    RawLogIndex index;
+    std::vector<uint8_t> block;
+    bool ok = ::write(fd, rawlog::kMagicV3, 8) == 8;
+    uint64_t file_off = 8;
+
+    std::size_t from = 0;
+    while (ok && from < size) {
+        // konec bloku na hranici záznamu
+        std::size_t to = from;
+        while (to + sizeof(LogRecordHeader) <= size) {
+            LogRecordHeader h;
+            std::memcpy(&h, recs + to, sizeof(h));
+            const std::size_t rec = sizeof(h) + h.payload_size;
+            if (h.payload_size > rawlog::kMaxPayload || to + rec > size) break;
+            if (to > from && to + rec - from > LidarRawLogger::kBufferBytes) break;
+            to += rec;
+        }
+        if (to == from || !encoder.encode(recs + from, to - from, block)) {
+            if (err) *err = "corrupt record stream";
+            ok = false;
+            break;
+        }
+        LogBlockHeader bh;
+        std::memcpy(&bh, block.data(), sizeof(bh));
+        index.entries.push_back(LogIndexEntry{bh.first_ts_ns, file_off, bh.first_seq, 0});
+
+        for (std::size_t done = 0; ok && done < block.size();) {
+            const ssize_t w = ::write(fd, block.data() + done, block.size() - done);
+            if (w < 0 && errno == EINTR) continue;
+            ok = w > 0;
+            done += ok ? static_cast<std::size_t>(w) : 0;
+        }
+        file_off += block.size();
+        from = to;
+    }
+    if (!ok && err && err->empty()) *err = "write failed: " + path;
+    ok = ::fsync(fd) == 0 && ok;
+    ok = ::close(fd) == 0 && ok;
+    return ok && index.save(RawLogIndex::sidecarPath(path));
+}
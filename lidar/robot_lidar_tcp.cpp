@@ -1,25 +1,84 @@
 // robot_lidar_tcp.cpp — TCP služba pro Robotour LiDAR
 // -----------------------------------------------------------------
 // • Poslouchá POUZE na 127.0.0.1:9002 (plain TCP)
-// • Příkazy: PING, START, STOP, DISTANCE, EXIT, SHUTDOWN
+// • Příkazy: PING, START, STOP, DISTANCE, CORIDORS, OBJECTS, TRACKS, GRID, HEIGHTMAP, TRAVERSE, NORMALS, CLEARANCE, ODOM, TRIGGER, RAWLOG, SUBSCRIBE, BINARY, STATS, MODE, EXIT, SHUTDOWN
 // • START/STOP volají LidarController (globální instance)
 // • DISTANCE vrací poslední minimální vzdálenost z LiDARu
+//   (překážka = bod nad lokální zemí podle segmentace země)
+// • DISTANCE <param>... – parametrizovaný dotaz (distance_query.hpp), např.
+//       DISTANCE zmin=-30 zmax=60 az=-30:30 age=300 footprint   → "1 <dist>"
+//   výsledky se cachují po ~75 ms (16 paketů, DistanceQueryCache);
+//   "DISTANCE neg [az=..] [footprint]" = nejbližší negativní překážka (hrana, díra)
+// • DISTANCE P<p> / DISTANCE K=<k> [az=..] – robustní varianta z průběžných histogramů
+//   (se zmin/zmax/age/footprint/neg nebo P i K naráz → "ERR DISTANCE PARSE"):
+//   p-tý percentil resp. k-tý nejbližší bod překážky, celkově i po sektorech
+//       "1 <dist> <n_sectors> <d_sektor0> ..."  (sektor 0 = -180°..-170°, krok 10°)
+// • CORIDORS vrací volné koridory z poslední otáčky:
+//       "<rev> <n> [<from°> <to°> <center°> <width_cm> <depth_cm>]..."
+// • OBJECTS vrací shluky překážek z poslední otáčky (nejbližší první, rámec robota, cm):
+//       "<rev> <n> [<id> <cx> <cy> <xmin> <ymin> <xmax> <ymax> <hmin> <hmax> <points> <nx> <ny> <nd>]..."
+//   (h = výška nad zemí, n* = nejbližší bod objektu a jeho vzdálenost)
+// • TRACKS vrací sledované objekty (potvrzené tracky, nejnebezpečnější první):
+//       "<rev> <n> [<id> <age> <x> <y> <nx> <ny> <vx> <vy> <speed> <t_cpa> <d_cpa>]..."
+//   (v = rychlost vůči zemi v osách robota [cm/s], cpa = predikované nejbližší
+//    přiblížení nejbližšího bodu: čas [s] a vzdálenost [cm])
+// • GRID vrací mřížku obsazenosti z poslední otáčky jako bitset v base64:
+//       "<rev> <size> <cell_cm> <x0_cm> <y0_cm> <pose_x> <pose_y> <yaw> <base64>"
+//   (plná data s počty zásahů jsou v shared memory /robot_lidar_grid)
+// • HEIGHTMAP vrací výškovou mapu z poslední otáčky (kompaktně, base64):
+//       "<rev> <size> <cell_cm> <x0_cm> <y0_cm> <pose_x> <pose_y> <yaw> <base64>"
+//   payload = int16 z_min[size²] | z_max[size²] | z_mean[size²] [cm], -32768 = bez dat
+//   (totéž i s Meta v shared memory /robot_lidar_heightmap)
+// • TRAVERSE <x_cm> <y_cm> <r_cm> – průjezdnost kruhu (skóre 0..250, 250 = nelze, 255 = neznámo):
+//       "<rev> <worst> <mean> <known_cells> <total_cells>"
+// • NORMALS <from_deg> <to_deg> – normály povrchu ve výřezu horizontálních úhlů
+//   LiDARu (řádky range image); výřez se tím předplatí a počítá se každou otáčku:
+//       "<rev> <n_rows> [<row> <h_angle_deg> <n> <base64 int8 nx,ny,nz × n>]..."
+//   (×127, rámec robota, 0 0 0 = bez normály; první dotaz typicky "-1 0")
+// • CLEARANCE <x_cm> <y_cm> vrací volný prostor kolem bodu (rámec robota):
+//       "<rev> <clearance_cm>"  (celé pole v shared memory /robot_lidar_clearance)
+// • ODOM <x_cm> <y_cm> <yaw_rad> – odometrie robota (kola/fusion) pro kompenzaci
+//   vlastního pohybu bodů v bufferu; odpověď "OK ODOM"
+// • TRIGGER [<důvod>] – uloží okno black boxu (~20 s před, 5 s po) do
+//   /data/robot/lidar/<datum>/blackbox-HH-MM-SS.dat; odpověď "OK TRIGGER",
+//   resp. "ERR TRIGGER BUSY" (okno k předchozí události je ještě otevřené)
+// • RAWLOG ON|OFF – průběžný raw log zap/vyp (black box běží dál); "OK RAWLOG ON|OFF",
+//   RAWLOG bez parametru vrací "RAWLOG ON|OFF"
+// • SUBSCRIBE CLOUD [<voxel_cm>] – náhledový cloud pro webové UI (cloud_stream.hpp);
+//   odpověď "OK SUBSCRIBE CLOUD <voxel_cm>" (voxel 2..200 cm, výchozí 10), dál už
+//   spojení nese jen binární rámce, jeden za otáčku:
+//       CloudFrameHeader (40 B, "L2CF") + n_points × {int16 x, y, z [cm], u8 intensity, u8 label}
+//   pomalý klient dostane vždy nejnovější otáčku (starší se přeskočí), odběr
+//   končí zavřením spojení
+// • BINARY <verze> – přepne spojení do binárního rámcového režimu (binary_protocol.hpp):
+//   odpověď "OK BINARY <v>" (resp. "ERR BINARY VERSION"), dál jen rámce
+//   FrameHeader {length, type, version, seq, ref, stamp_ns} + payload; textové
+//   příkazy v rámcích Text, snapshoty (GRID, HEIGHTMAP, CLEARANCE, OBJECTS, ...)
+//   binárně přímo z publikovaných bufferů, cloud jako push rámce Cloud
+// • STATS vrací cenu stupňů zpracování: "<stage> calls=.. avg_ns=.. max_ns=.. ns_per_item=.." [| ...]
+//   + odmítání osamocených bodů: "outliers checked=.. rejected=.. weak=.. rate=.."
 // • Všechny příkazy se logují na stdout
 // • Build: g++ -std=c++17 -pthread robot_lidar_tcp.cpp -o robot_lidar_tcp
 // -----------------------------------------------------------------
 
 #include "lidar_controller.hpp"   // náš wrapper
+#include "binary_protocol.hpp"
 
+#include <array>
 #include <atomic>
 #include <cerrno>
 #include <csignal>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <mutex>
+#include <memory>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <poll.h>
 #include <string>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <thread>
 #include <unistd.h>
 #include <vector>
@@ -46,6 +105,39 @@ void send_line(int sock, const std::string &msg) {
     ::send(sock, out.data(), out.size(), MSG_NOSIGNAL);
 }
 
+// Celý buffer, nebo false (klient zavřel / nestíhá déle než SO_SNDTIMEO).
+bool send_all(int sock, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(sock, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string base64_encode(const std::vector<uint8_t> &in) {
+    static const char tbl[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < in.size(); i += 3) {
+        uint32_t v = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        out += tbl[(v >> 18) & 63]; out += tbl[(v >> 12) & 63];
+        out += tbl[(v >> 6) & 63];  out += tbl[v & 63];
+    }
+    if (i < in.size()) {
+        uint32_t v = in[i] << 16;
+        if (i + 1 < in.size()) v |= in[i + 1] << 8;
+        out += tbl[(v >> 18) & 63]; out += tbl[(v >> 12) & 63];
+        out += (i + 1 < in.size()) ? tbl[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
 void close_all_clients() {
     std::lock_guard<std::mutex> lg(clients_mtx);
     for (int s : client_socks) {
@@ -60,6 +152,347 @@ void stop_listener() {
     if (fd >= 0) { ::shutdown(fd, SHUT_RDWR); ::close(fd); }
 }
 
+// ------------------------------------------------------
+// Textové příkazy (bez řízení spojení) → odpověď bez '\n'
+// Sdílí textový i binární režim (MsgType::Text).
+// ------------------------------------------------------
+std::string run_command(const std::string &line) {
+    if (line == "PING") {
+        return "PONG LIDAR";
+    } else if (line == "START") {
+        bool ok = lidar.start();
+        return ok ? "OK STARTED" : "ERR START";
+    } else if (line == "STOP") {
+        lidar.stop();
+        return "OK STOPPED";
+    } else if (line == "DISTANCE") {
+        //uint64_t seq;
+        float dist;
+        if (lidar.getDistance(dist)) {
+            return std::to_string(1) + " " + std::to_string(dist);
+        } else {
+            return "-1 -1";   // vzdálenost zatím není známa
+        }
+    } else if (line.rfind("DISTANCE ", 0) == 0) {
+        DistanceQuery q;
+        float dist;
+        if (!q.parse(line.substr(9))) {
+            return "ERR DISTANCE PARSE";
+        } else if (!lidar.getDistance(q, dist)) {
+            return "-1 -1";
+        } else if (q.robust()) {
+            std::array<float, DistanceHistogram::kSectors> sec;
+            lidar.getDistanceSectors(q, sec);
+            std::string out = "1 " + std::to_string(dist) + " " + std::to_string(sec.size());
+            for (float d : sec) out += " " + std::to_string(d);
+            return out;
+        } else {
+            return "1 " + std::to_string(dist);
+        }
+    } else if (line == "CORIDORS") {
+        CorridorSet cs;
+        if (lidar.getCorridors(cs)) {
+            return cs.toLine();
+        } else {
+            return "-1 0";    // koridory zatím nejsou známy
+        }
+    } else if (line == "OBJECTS") {
+        ObjectList ol;
+        if (lidar.getObjects(ol)) {
+            return ol.toLine();
+        } else {
+            return "-1 0";    // objekty zatím nejsou známy
+        }
+    } else if (line == "TRACKS") {
+        TrackList tl;
+        if (lidar.getTracks(tl)) {
+            return tl.toLine();
+        } else {
+            return "-1 0";    // tracker zatím nemá data
+        }
+    } else if (line == "GRID") {
+        std::shared_ptr<const EgoOccupancyGrid::Snapshot> g;
+        if (lidar.getGrid(g)) {
+            const auto &m = g->meta;
+            return std::to_string(m.rev) + " " +
+                   std::to_string(m.size) + " " +
+                   std::to_string(m.cell_cm) + " " +
+                   std::to_string(m.origin_cx * m.cell_cm) + " " +
+                   std::to_string(m.origin_cy * m.cell_cm) + " " +
+                   std::to_string(m.pose_x_cm) + " " +
+                   std::to_string(m.pose_y_cm) + " " +
+                   std::to_string(m.pose_yaw) + " " +
+                   base64_encode(EgoOccupancyGrid::toBitset(*g));
+        } else {
+            return "-1";      // mřížka zatím není
+        }
+    } else if (line == "HEIGHTMAP") {
+        std::shared_ptr<const HeightMap::Snapshot> h;
+        if (lidar.getHeightMap(h)) {
+            const auto &m = h->meta;
+            std::vector<uint8_t> payload(HeightMap::kExportBytes);
+            HeightMap::exportTo(*h, payload.data());
+            payload.erase(payload.begin(), payload.begin() + sizeof(m));
+            return std::to_string(m.rev) + " " +
+                   std::to_string(m.size) + " " +
+                   std::to_string(m.cell_cm) + " " +
+                   std::to_string(m.origin_cx * m.cell_cm) + " " +
+                   std::to_string(m.origin_cy * m.cell_cm) + " " +
+                   std::to_string(m.pose_x_cm) + " " +
+                   std::to_string(m.pose_y_cm) + " " +
+                   std::to_string(m.pose_yaw) + " " +
+                   base64_encode(payload);
+        } else {
+            return "-1";      // výšková mapa zatím není
+        }
+    } else if (line.rfind("TRAVERSE ", 0) == 0) {
+        float x = 0.0f, y = 0.0f, r = 0.0f;
+        uint32_t rev = 0;
+        HeightMap::Region reg;
+        if (std::sscanf(line.c_str() + 9, "%f %f %f", &x, &y, &r) != 3 || r < 0.0f) {
+            return "ERR TRAVERSE PARSE";
+        } else if (lidar.getTraversability(x, y, r, rev, reg)) {
+            return std::to_string(rev) + " " +
+                   std::to_string(reg.worst) + " " +
+                   std::to_string(reg.mean) + " " +
+                   std::to_string(reg.known) + " " +
+                   std::to_string(reg.total);
+        } else {
+            return "-1 -1";   // není spočteno / mimo mapu
+        }
+    } else if (line.rfind("NORMALS ", 0) == 0) {
+        float a = 0.0f, b = 0.0f;
+        NormalSet ns;
+        if (std::sscanf(line.c_str() + 8, "%f %f", &a, &b) != 2) {
+            return "ERR NORMALS PARSE";
+        } else if (lidar.getNormals(a, b, ns)) {
+            std::string out = std::to_string(ns.rev) + " " + std::to_string(ns.rows.size());
+            for (const auto &r : ns.rows) {
+                out += " " + std::to_string(r.row) + " " +
+                       std::to_string(r.h_angle * 180.0f / static_cast<float>(M_PI)) + " " +
+                       std::to_string(r.n) + " " +
+                       base64_encode(std::vector<uint8_t>(r.normals.begin(), r.normals.end()));
+            }
+            return out;
+        } else {
+            return "-1 0";    // předplaceno, normály od další otáčky
+        }
+    } else if (line.rfind("CLEARANCE ", 0) == 0) {
+        float x = 0.0f, y = 0.0f;
+        uint32_t rev = 0;
+        float clr = -1.0f;
+        if (std::sscanf(line.c_str() + 10, "%f %f", &x, &y) != 2) {
+            return "ERR CLEARANCE PARSE";
+        } else if (lidar.getClearance(x, y, rev, clr)) {
+            return std::to_string(rev) + " " + std::to_string(clr);
+        } else {
+            return "-1 -1";   // není spočteno / mimo mřížku
+        }
+    } else if (line.rfind("ODOM ", 0) == 0) {
+        float x = 0.0f, y = 0.0f, yaw = 0.0f;
+        if (std::sscanf(line.c_str() + 5, "%f %f %f", &x, &y, &yaw) != 3) {
+            return "ERR ODOM PARSE";
+        } else {
+            lidar.setOdometry(x, y, yaw);
+            return "OK ODOM";
+        }
+    } else if (line == "TRIGGER" || line.rfind("TRIGGER ", 0) == 0) {
+        const std::string reason = line.size() > 8 ? line.substr(8) : "tcp";
+        if (lidar.triggerBlackBox(reason)) {
+            return "OK TRIGGER";
+        } else {
+            return "ERR TRIGGER BUSY";
+        }
+    } else if (line == "RAWLOG") {
+        return lidar.rawLogEnabled() ? "RAWLOG ON" : "RAWLOG OFF";
+    } else if (line == "RAWLOG ON" || line == "RAWLOG OFF") {
+        lidar.setRawLogEnabled(line == "RAWLOG ON");
+        return "OK " + line;
+    } else if (line == "STATS") {
+        return lidar.statsLine();
+    } else if (line.rfind("MODE ", 0) == 0) {
+        std::string arg = line.substr(5);
+        char *end = nullptr;
+        errno = 0;
+        long val = std::strtol(arg.c_str(), &end, 0); // base 0 => 10, 0x10, 020 atd.
+
+        if (errno != 0 || end == arg.c_str() || val < 0 || val > 0xFFFFFFFFul) {
+            return "ERR MODE PARSE";
+        } else {
+            uint32_t mode = static_cast<uint32_t>(val);
+            bool ok = lidar.setMode(mode);  // nová metoda viz níže
+            if (ok) {
+                return "OK MODE " + std::to_string(mode);
+            } else {
+                return "ERR MODE APPLY";
+            }
+        }
+
+    } else {
+        return "ERR UNKNOWN COMMAND";
+    }
+}
+
+// ------------------------------------------------------
+// Odběr cloudu jednoho spojení (cloud_stream.hpp): nejnovější otáčka
+// zvoxelizovaná do vlastního bufferu, pomalý klient otáčky přeskakuje
+// ------------------------------------------------------
+struct CloudSubscription {
+    explicit CloudSubscription(unsigned voxel_cm) : voxels(voxel_cm) { lidar.subscribeCloud(true); }
+    ~CloudSubscription() { lidar.subscribeCloud(false); }
+
+    CloudSubscription(const CloudSubscription &) = delete;
+    CloudSubscription &operator=(const CloudSubscription &) = delete;
+
+    // Rámec L2CF další otáčky ve frame; false = nic nového do timeout_ms.
+    bool next(int timeout_ms) {
+        std::shared_ptr<const CloudSnapshot> cloud;
+        if (!lidar.waitCloud(last_rev, timeout_ms, cloud)) return false;
+        CloudStreamStats &st = lidar.cloudStreamStats();
+        if (last_rev != 0 && cloud->rev > last_rev + 1) {
+            st.skipped.fetch_add(cloud->rev - last_rev - 1, std::memory_order_relaxed);
+        }
+        last_rev = cloud->rev;
+        StageTimer t(st.voxel, cloud->points.size());
+        voxels.run(*cloud, frame);
+        return true;
+    }
+
+    void sent() {
+        CloudStreamStats &st = lidar.cloudStreamStats();
+        st.frames.fetch_add(1, std::memory_order_relaxed);
+        st.bytes.fetch_add(frame.size(), std::memory_order_relaxed);
+    }
+
+    VoxelDownsampler     voxels;
+    std::vector<uint8_t> frame;
+    uint64_t             last_rev = 0;
+};
+
+// zaseknutý klient se odpojí, nečeká se na něj věčně
+void set_send_timeout(int sock) {
+    timeval tv{2, 0};
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// ------------------------------------------------------
+// SUBSCRIBE CLOUD – holé rámce L2CF až do zavření spojení
+// ------------------------------------------------------
+void stream_cloud(int sock, unsigned voxel_cm) {
+    set_send_timeout(sock);
+    CloudSubscription cloud(voxel_cm);
+
+    while (!shutting_down.load()) {
+        if (cloud.next(500)) {
+            if (!send_all(sock, cloud.frame.data(), cloud.frame.size())) break;
+            cloud.sent();
+        }
+        // vstup se ignoruje, jen se pozná zavřené spojení
+        char tmp[64];
+        ssize_t n = ::recv(sock, tmp, sizeof(tmp), MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) break;
+    }
+}
+
+// ------------------------------------------------------
+// BINARY – rámcový režim (binary_protocol.hpp) až do zavření spojení
+// ------------------------------------------------------
+
+// Odpověď na jeden rámec; payloady jdou přímo ze sdílených snapshotů.
+// false = spojení je pryč.
+bool handle_frame(FrameWriter &out, const FrameHeader &h, const std::string &payload,
+                  std::unique_ptr<CloudSubscription> &cloud) {
+    const uint32_t ref = h.seq;
+    const auto type = static_cast<MsgType>(h.type);
+    switch (type) {
+    case MsgType::Text:
+        return out.sendText(MsgType::Text, ref, run_command(payload));
+    case MsgType::Corridors: {
+        std::shared_ptr<const CorridorSet> c;
+        if (!lidar.getCorridors(c)) return out.send(type, ref, {});
+        return out.sendList(type, ref, c->rev, c->corridors);
+    }
+    case MsgType::Objects: {
+        std::shared_ptr<const ObjectList> o;
+        if (!lidar.getObjects(o)) return out.send(type, ref, {});
+        return out.sendList(type, ref, o->rev, o->objects);
+    }
+    case MsgType::Tracks: {
+        std::shared_ptr<const TrackList> t;
+        if (!lidar.getTracks(t)) return out.send(type, ref, {});
+        return out.sendList(type, ref, t->rev, t->tracks);
+    }
+    case MsgType::Grid: {
+        std::shared_ptr<const EgoOccupancyGrid::Snapshot> g;
+        if (!lidar.getGrid(g)) return out.send(type, ref, {});
+        return out.send(type, ref, {FrameWriter::part(&g->meta, sizeof(g->meta)),
+                                    FrameWriter::part(g->hits.data(), g->hits.size())});
+    }
+    case MsgType::HeightMap: {
+        std::shared_ptr<const HeightMap::Snapshot> hm;
+        if (!lidar.getHeightMap(hm)) return out.send(type, ref, {});
+        return out.send(type, ref, {FrameWriter::part(&hm->meta, sizeof(hm->meta)),
+                                    FrameWriter::part(hm->z_min.data(), hm->z_min.size() * sizeof(int16_t)),
+                                    FrameWriter::part(hm->z_max.data(), hm->z_max.size() * sizeof(int16_t)),
+                                    FrameWriter::part(hm->z_mean.data(), hm->z_mean.size() * sizeof(int16_t))});
+    }
+    case MsgType::Clearance: {
+        std::shared_ptr<const DistanceTransform::Result> c;
+        if (!lidar.getClearanceMap(c)) return out.send(type, ref, {});
+        return out.send(type, ref, {FrameWriter::part(&c->meta, sizeof(c->meta)),
+                                    FrameWriter::part(c->clearance_cm.data(),
+                                                      c->clearance_cm.size() * sizeof(float))});
+    }
+    case MsgType::SubscribeCloud: {
+        uint16_t voxel = 0;
+        if (payload.size() != sizeof(voxel)) {
+            return out.sendText(MsgType::Error, ref, "ERR SUBSCRIBE PARSE");
+        }
+        std::memcpy(&voxel, payload.data(), sizeof(voxel));
+        cloud.reset();
+        if (voxel > 0) cloud = std::make_unique<CloudSubscription>(voxel);
+        return out.send(type, ref, {});
+    }
+    default:
+        return out.sendText(MsgType::Error, ref, "ERR UNKNOWN TYPE");
+    }
+}
+
+// pending = bajty přijaté za řádkem BINARY (už první rámce)
+void binary_session(int sock, uint16_t version, const std::string &pending) {
+    set_send_timeout(sock);
+    FrameReader in;
+    in.append(pending.data(), pending.size());
+    FrameWriter out(sock, version);
+    std::unique_ptr<CloudSubscription> cloud;
+
+    FrameHeader h{};
+    std::string payload;
+    char tmp[4096];
+    bool ok = true;
+    while (ok && !shutting_down.load()) {
+        while (ok && in.next(h, payload)) {
+            ok = handle_frame(out, h, payload, cloud);
+        }
+        if (!ok || in.bad()) break;
+
+        if (cloud && cloud->next(0)) {
+            ok = out.send(MsgType::Cloud, 0, {FrameWriter::part(cloud->frame.data(), cloud->frame.size())});
+            if (ok) cloud->sent();
+        }
+
+        // s odběrem cloudu kratší čekání, aby otáčky nestály ve frontě
+        pollfd p{sock, POLLIN, 0};
+        int r = ::poll(&p, 1, cloud ? 20 : 500);
+        if (r < 0 && errno != EINTR) break;
+        if (r > 0) {
+            ssize_t n = ::recv(sock, tmp, sizeof(tmp), 0);
+            if (n <= 0) break;
+            in.append(tmp, static_cast<size_t>(n));
+        }
+    }
+}
+
 // ------------------------------------------------------
 // Vlákno pro každého klienta
 // ------------------------------------------------------
@@ -86,42 +519,29 @@ void handle_client(int sock) {
 
             //std::cout << "CMD(" << sock << "): " << line << std::endl;
 
-            if (line == "PING") {
-                send_line(sock, "PONG LIDAR");
-            } else if (line == "START") {
-                bool ok = lidar.start();
-                send_line(sock, ok ? "OK STARTED" : "ERR START");
-            } else if (line == "STOP") {
-                lidar.stop();
-                send_line(sock, "OK STOPPED");
-            } else if (line == "DISTANCE") {
-                //uint64_t seq;
-                float dist;
-                if (lidar.getDistance(dist)) {
-                    send_line(sock, std::to_string(1) + " " + std::to_string(dist));
-                } else {
-                    send_line(sock, "-1 -1");   // vzdálenost zatím není známa
+            if (line == "BINARY" || line.rfind("BINARY ", 0) == 0) {
+                unsigned ver = 0;
+                if (std::sscanf(line.c_str() + 6, "%u", &ver) != 1 || ver < 1) {
+                    send_line(sock, "ERR BINARY VERSION");
+                    continue;
                 }
-            } else if (line == "CORIDORS") {
-                
-            } else if (line.rfind("MODE ", 0) == 0) {
-                std::string arg = line.substr(5);
-                char *end = nullptr;
-                errno = 0;
-                long val = std::strtol(arg.c_str(), &end, 0); // base 0 => 10, 0x10, 020 atd.
-
-                if (errno != 0 || end == arg.c_str() || val < 0 || val > 0xFFFFFFFFul) {
-                    send_line(sock, "ERR MODE PARSE");
-                } else {
-                    uint32_t mode = static_cast<uint32_t>(val);
-                    bool ok = lidar.setMode(mode);  // nová metoda viz níže
-                    if (ok) {
-                        send_line(sock, "OK MODE " + std::to_string(mode));
-                    } else {
-                        send_line(sock, "ERR MODE APPLY");
-                    }
+                ver = std::min<unsigned>(ver, binproto::kVersion);
+                send_line(sock, "OK BINARY " + std::to_string(ver));
+                // zbytek bufferu už jsou rámce
+                binary_session(sock, static_cast<uint16_t>(ver), buffer);
+                ::shutdown(sock, SHUT_RDWR);
+                break;
+            } else if (line == "SUBSCRIBE CLOUD" || line.rfind("SUBSCRIBE CLOUD ", 0) == 0) {
+                unsigned voxel = VoxelDownsampler::kDefaultVoxelCm;
+                if (line.size() > 16 && std::sscanf(line.c_str() + 16, "%u", &voxel) != 1) {
+                    send_line(sock, "ERR SUBSCRIBE PARSE");
+                    continue;
                 }
-
+                voxel = std::clamp(voxel, VoxelDownsampler::kMinVoxelCm, VoxelDownsampler::kMaxVoxelCm);
+                send_line(sock, "OK SUBSCRIBE CLOUD " + std::to_string(voxel));
+                stream_cloud(sock, voxel);
+                ::shutdown(sock, SHUT_RDWR);
+                break;
             } else if (line == "EXIT") {
                 send_line(sock, "BYE LIDAR");
                 ::shutdown(sock, SHUT_RDWR);
@@ -133,7 +553,7 @@ void handle_client(int sock) {
                 stop_listener();
                 break;
             } else {
-                send_line(sock, "ERR UNKNOWN COMMAND");
+                send_line(sock, run_command(line));
             }
         }
     }
@@ -0,0 +1,112 @@
+#pragma once
+
+// shm_publisher.hpp — export dat do POSIX shared memory (/dev/shm)
+// ---------------------------------------------------------------------------
+// • Jeden zapisovatel (vlákno LiDARu), libovolně čtenářů v jiných procesech.
+// • Konzistence přes seqlock: seq je liché během zápisu; čtenář si přečte seq,
+//   zkopíruje payload, přečte seq znovu a pokud se liší (nebo je liché), opakuje.
+// • Rozložení regionu: ShmHeader (64 B) + payload (payload_size B).
+// ---------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct ShmHeader
+{
+    std::atomic<std::uint32_t> seq;     // seqlock (liché = zápis probíhá)
+    std::uint32_t magic;                // 'L2SH'
+    std::uint32_t version;              // verze konkrétního payloadu
+    std::uint32_t payload_size;         // velikost payloadu v bajtech
+    std::uint64_t stamp_ns;             // monotonic čas publikace
+    std::uint64_t count;                // počet publikací
+    std::uint8_t  reserved[32];
+};
+
+static_assert(sizeof(ShmHeader) == 64, "ShmHeader must be 64 bytes");
+
+class ShmPublisher
+{
+public:
+    static constexpr std::uint32_t kMagic = 0x4853324Cu; // "L2SH"
+
+    ShmPublisher(const std::string &name, std::size_t payload_size, std::uint32_t version = 1)
+        : name_(name), payload_size_(payload_size)
+    {
+        const std::size_t total = sizeof(ShmHeader) + payload_size_;
+
+        int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            std::cerr << "[ShmPublisher] shm_open failed: " << name_ << std::endl;
+            return;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            std::cerr << "[ShmPublisher] ftruncate failed: " << name_ << std::endl;
+            ::close(fd);
+            return;
+        }
+        void *p = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            std::cerr << "[ShmPublisher] mmap failed: " << name_ << std::endl;
+            return;
+        }
+
+        base_ = static_cast<std::uint8_t *>(p);
+        size_ = total;
+
+        hdr_ = new (base_) ShmHeader;
+        hdr_->seq.store(0, std::memory_order_relaxed);
+        hdr_->magic        = kMagic;
+        hdr_->version      = version;
+        hdr_->payload_size = static_cast<std::uint32_t>(payload_size_);
+        hdr_->stamp_ns     = 0;
+        hdr_->count        = 0;
+    }
+
+    ~ShmPublisher()
+    {
+        if (base_) {
+            ::munmap(base_, size_);
+            ::shm_unlink(name_.c_str());
+        }
+    }
+
+    ShmPublisher(const ShmPublisher &) = delete;
+    ShmPublisher &operator=(const ShmPublisher &) = delete;
+
+    bool ok() const { return base_ != nullptr; }
+    const std::string &name() const { return name_; }
+
+    // fill(uint8_t *payload) zapíše payload; celé je obalené seqlockem.
+    template <typename F>
+    void publish(std::uint64_t stamp_ns, F &&fill)
+    {
+        if (!base_) return;
+
+        const std::uint32_t s = hdr_->seq.load(std::memory_order_relaxed);
+        hdr_->seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        fill(base_ + sizeof(ShmHeader));
+        hdr_->stamp_ns = stamp_ns;
+        hdr_->count++;
+
+        std::atomic_thread_fence(std::memory_order_release);
+        hdr_->seq.store(s + 2, std::memory_order_relaxed);
+    }
+
+private:
+    std::string   name_;
+    std::size_t   payload_size_{0};
+    std::uint8_t *base_{nullptr};
+    std::size_t   size_{0};
+    ShmHeader    *hdr_{nullptr};
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+// stage_stats.hpp — měření ceny jednotlivých stupňů zpracování
+// ---------------------------------------------------------------------------
+// • StageStats: počet volání, počet zpracovaných prvků (bodů), součet a
+//   maximum doby v ns. Zapisuje jedno vlákno (loopRead), číst lze odkudkoli
+//   (relaxed atomiky, hodnoty jsou jen orientační).
+// • StageTimer: RAII měření jednoho volání.
+// • Výpis přes TCP příkaz STATS: "<name> calls=.. avg_ns=.. max_ns=.. ns_per_item=.."
+// ---------------------------------------------------------------------------
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+struct StageStats
+{
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> items{0};
+    std::atomic<std::uint64_t> total_ns{0};
+    std::atomic<std::uint64_t> max_ns{0};
+
+    void add(std::uint64_t ns, std::uint64_t n_items)
+    {
+        calls.store(calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        items.store(items.load(std::memory_order_relaxed) + n_items, std::memory_order_relaxed);
+        total_ns.store(total_ns.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        if (ns > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(ns, std::memory_order_relaxed);
+        }
+    }
+
+    void reset()
+    {
+        calls.store(0, std::memory_order_relaxed);
+        items.store(0, std::memory_order_relaxed);
+        total_ns.store(0, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+
+    std::string toString(const char *name) const
+    {
+        const std::uint64_t c = calls.load(std::memory_order_relaxed);
+        const std::uint64_t n = items.load(std::memory_order_relaxed);
+        const std::uint64_t t = total_ns.load(std::memory_order_relaxed);
+        std::ostringstream os;
+        os << name
+           << " calls=" << c
+           << " avg_ns=" << (c ? t / c : 0)
+           << " max_ns=" << max_ns.load(std::memory_order_relaxed)
+           << " ns_per_item=" << (n ? static_cast<double>(t) / n : 0.0);
+        return os.str();
+    }
+};
+
+class StageTimer
+{
+public:
+    StageTimer(StageStats &st, std::uint64_t n_items)
+        : st_(st), n_(n_items), t0_(std::chrono::steady_clock::now()) {}
+
+    ~StageTimer()
+    {
+        const auto dt = std::chrono::steady_clock::now() - t0_;
+        st_.add(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count()),
+                n_);
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    StageStats &st_;
+    std::uint64_t n_;
+    std::chrono::steady_clock::time_point t0_;
+};
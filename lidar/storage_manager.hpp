@@ -0,0 +1,282 @@
+#pragma once
+
+// storage_manager.hpp — hlídání místa pro logy v /data/robot/lidar
+// ---------------------------------------------------------------------------
+// • Vlastní vlákno, každých kCheckIntervalMs:
+//     statvfs() kořene → volné místo,
+//     jednou za kScanIntervalNs (nebo hned při nedostatku místa) průchod
+//     stromem logů → obsazené místo a počet souborů.
+// • Kvóta: když logy přesáhnou kQuotaBytes, nebo volné místo klesne pod
+//   kKeepFreeBytes, mažou se nejstarší soubory (podle mtime). Soubory
+//   změněné v posledních kKeepRecentS se nemažou (rozepsaný raw log),
+//   blackbox-*.dat (incidenty) jdou na řadu až po všem ostatním. Prázdné
+//   adresáře (datum, points-HH) se uklidí.
+// • Když mazání nestačí, logování se degraduje po stupních (StorageLevel):
+//     Normal   – vše,
+//     NoPly    – bez PLY dumpů bufferu (free < kFreePlyBytes),
+//     Decimate – raw log jen každý kDecimate-tý point paket (< kFreeDecimateBytes),
+//     RawOff   – bez průběžného raw logu (< kFreeRawOffBytes; black box běží).
+//   Zpět o stupeň níž až s rezervou kHysteresisPct – stav neosciluje.
+// • Rotace raw logu: kRawFileBytes / kRawFileNs (předává se LidarRawLogger).
+// • Čtení stavu (level, plyAllowed, rawDecimation) je lock-free, volá se
+//   z loopRead u každého paketu. TCP STATS: "storage level=.. free_mb=.. ..".
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>   // C++17
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/statvfs.h>
+
+#include "stage_stats.hpp"
+
+enum class StorageLevel : std::uint8_t {
+    Normal   = 0,
+    NoPly    = 1,
+    Decimate = 2,
+    RawOff   = 3,
+};
+
+class StorageManager
+{
+public:
+    static constexpr std::uint64_t kMiB = 1ull << 20;
+    static constexpr std::uint64_t kQuotaBytes = 16384 * kMiB;        // logy celkem
+    static constexpr std::uint64_t kKeepFreeBytes = 3072 * kMiB;      // mazání pod touto hranicí
+    static constexpr std::uint64_t kFreePlyBytes = 2048 * kMiB;
+    static constexpr std::uint64_t kFreeDecimateBytes = 1024 * kMiB;
+    static constexpr std::uint64_t kFreeRawOffBytes = 256 * kMiB;
+    static constexpr unsigned      kHysteresisPct = 25;
+    static constexpr unsigned      kDecimate = 4;
+    static constexpr std::uint64_t kRawFileBytes = 256 * kMiB;        // rotace raw logu
+    static constexpr std::uint64_t kRawFileNs = 15ull * 60 * 1000000000ull;
+    static constexpr int           kCheckIntervalMs = 2000;
+    static constexpr std::uint64_t kScanIntervalNs = 30ull * 1000000000ull;
+    static constexpr int           kKeepRecentS = 120;
+
+    explicit StorageManager(const std::string &root = "/data/robot/lidar")
+        : root_(root)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(root_, ec);
+        worker_ = std::thread(&StorageManager::loop, this);
+    }
+
+    ~StorageManager()
+    {
+        {
+            std::lock_guard<std::mutex> lg(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    StorageManager(const StorageManager &) = delete;
+    StorageManager &operator=(const StorageManager &) = delete;
+
+    StorageLevel level() const
+    {
+        return static_cast<StorageLevel>(level_.load(std::memory_order_relaxed));
+    }
+
+    bool plyAllowed() const { return level() == StorageLevel::Normal; }
+
+    // Každý kolikátý point paket jde do raw logu (0 = raw log vypnout).
+    unsigned rawDecimation() const
+    {
+        switch (level()) {
+        case StorageLevel::Normal:
+        case StorageLevel::NoPly:    return 1;
+        case StorageLevel::Decimate: return kDecimate;
+        default:                     return 0;
+        }
+    }
+
+    static const char *levelName(StorageLevel l)
+    {
+        switch (l) {
+        case StorageLevel::Normal:   return "normal";
+        case StorageLevel::NoPly:    return "no_ply";
+        case StorageLevel::Decimate: return "decimate";
+        default:                     return "raw_off";
+        }
+    }
+
+    // "<name> level=.. free_mb=.. used_mb=.. files=.. pruned=.. pruned_mb=.. errors=.. | <name>_scan .."
+    std::string toString(const char *name) const
+    {
+        std::ostringstream os;
+        os << name
+           << " level=" << levelName(level())
+           << " free_mb=" << free_.load(std::memory_order_relaxed) / kMiB
+           << " used_mb=" << used_.load(std::memory_order_relaxed) / kMiB
+           << " files=" << files_.load(std::memory_order_relaxed)
+           << " pruned=" << pruned_.load(std::memory_order_relaxed)
+           << " pruned_mb=" << pruned_bytes_.load(std::memory_order_relaxed) / kMiB
+           << " errors=" << errors_.load(std::memory_order_relaxed);
+        return os.str() + " | " + scan_stats_.toString((std::string(name) + "_scan").c_str());
+    }
+
+private:
+    struct FileInfo {
+        std::filesystem::path path;
+        std::uint64_t size;
+        std::filesystem::file_time_type mtime;
+        bool incident;           // blackbox-* – maže se až nakonec
+    };
+
+    void loop()
+    {
+        uint64_t last_scan = 0;
+        std::unique_lock<std::mutex> lk(mtx_);
+        while (!stop_) {
+            lk.unlock();
+            const uint64_t now = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+            uint64_t free_b = 0;
+            if (freeBytes(free_b)) {
+                if (last_scan == 0 || now - last_scan >= kScanIntervalNs || free_b < kKeepFreeBytes) {
+                    last_scan = now;
+                    scanAndPrune(free_b);
+                    freeBytes(free_b);
+                }
+                free_.store(free_b, std::memory_order_relaxed);
+                updateLevel(free_b);
+            }
+            lk.lock();
+            cv_.wait_for(lk, std::chrono::milliseconds(kCheckIntervalMs), [this] { return stop_; });
+        }
+    }
+
+    bool freeBytes(uint64_t &out)
+    {
+        struct statvfs vs{};
+        if (::statvfs(root_.c_str(), &vs) != 0) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        out = static_cast<uint64_t>(vs.f_bavail) * vs.f_frsize;
+        return true;
+    }
+
+    // Stupeň pro dané volné místo (bez hystereze).
+    static StorageLevel levelFor(uint64_t free_b)
+    {
+        if (free_b < kFreeRawOffBytes) return StorageLevel::RawOff;
+        if (free_b < kFreeDecimateBytes) return StorageLevel::Decimate;
+        if (free_b < kFreePlyBytes) return StorageLevel::NoPly;
+        return StorageLevel::Normal;
+    }
+
+    void updateLevel(uint64_t free_b)
+    {
+        const uint8_t cur = level_.load(std::memory_order_relaxed);
+        const uint8_t strict = static_cast<uint8_t>(levelFor(free_b));
+        uint8_t next = strict;
+        if (strict < cur) {
+            // zlepšení jen s rezervou nad prahem
+            const uint64_t reserve = free_b * 100 / (100 + kHysteresisPct);
+            next = std::max(strict, static_cast<uint8_t>(levelFor(reserve)));
+        }
+        if (next != cur) {
+            level_.store(next, std::memory_order_relaxed);
+            std::cout << "[storage] level " << levelName(static_cast<StorageLevel>(cur)) << " -> "
+                      << levelName(static_cast<StorageLevel>(next))
+                      << " (free " << free_b / kMiB << " MiB)" << std::endl;
+        }
+    }
+
+    // Průchod stromem logů, kvóta + mazání nejstarších souborů.
+    void scanAndPrune(uint64_t free_b)
+    {
+        namespace fs = std::filesystem;
+        StageTimer t(scan_stats_, files_.load(std::memory_order_relaxed));
+
+        std::vector<FileInfo> files;
+        std::vector<fs::path> dirs;
+        uint64_t used = 0;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root_, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            std::error_code e2;
+            if (it->is_directory(e2)) {
+                dirs.push_back(it->path());
+                continue;
+            }
+            if (!it->is_regular_file(e2)) continue;
+            FileInfo f{it->path(), it->file_size(e2), it->last_write_time(e2), false};
+            if (e2) continue;
+            f.incident = f.path.filename().string().rfind("blackbox-", 0) == 0;
+            used += f.size;
+            files.push_back(std::move(f));
+        }
+        if (ec) errors_.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t need = used > kQuotaBytes ? used - kQuotaBytes : 0;
+        if (free_b < kKeepFreeBytes) need = std::max(need, kKeepFreeBytes - free_b);
+
+        if (need > 0) {
+            std::sort(files.begin(), files.end(), [](const FileInfo &a, const FileInfo &b) {
+                return a.incident != b.incident ? b.incident : a.mtime < b.mtime;
+            });
+            const auto keep_after = fs::file_time_type::clock::now() - std::chrono::seconds(kKeepRecentS);
+            uint64_t freed = 0;
+            std::size_t removed = 0;
+            for (const FileInfo &f : files) {
+                if (freed >= need) break;
+                if (f.mtime > keep_after) continue;
+                std::error_code e2;
+                if (fs::remove(f.path, e2)) {
+                    freed += f.size;
+                    ++removed;
+                } else if (e2) {
+                    errors_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            used -= std::min(used, freed);
+            files_.store(files.size() - removed, std::memory_order_relaxed);
+            pruned_.fetch_add(removed, std::memory_order_relaxed);
+            pruned_bytes_.fetch_add(freed, std::memory_order_relaxed);
+
+            // prázdné adresáře, nejhlubší první (neprázdné remove odmítne)
+            std::sort(dirs.begin(), dirs.end(), [](const fs::path &a, const fs::path &b) {
+                return a.native().size() > b.native().size();
+            });
+            for (const fs::path &d : dirs) {
+                std::error_code e2;
+                fs::remove(d, e2);
+            }
+        } else {
+            files_.store(files.size(), std::memory_order_relaxed);
+        }
+        used_.store(used, std::memory_order_relaxed);
+    }
+
+    std::string root_;
+    std::atomic<uint8_t> level_{static_cast<uint8_t>(StorageLevel::Normal)};
+
+    std::atomic<std::uint64_t> free_{0};
+    std::atomic<std::uint64_t> used_{0};
+    std::atomic<std::uint64_t> files_{0};
+    std::atomic<std::uint64_t> pruned_{0};
+    std::atomic<std::uint64_t> pruned_bytes_{0};
+    std::atomic<std::uint64_t> errors_{0};
+    StageStats scan_stats_;
+
+    std::mutex              mtx_;
+    std::condition_variable cv_;
+    bool                    stop_ = false;
+    std::thread             worker_;
+};
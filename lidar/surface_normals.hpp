@@ -0,0 +1,202 @@
+#pragma once
+
+// surface_normals.hpp — normály povrchu z organizovaného range image
+// ---------------------------------------------------------------------------
+// • Normála buňky (r, c) = (P[r][c+1] - P[r][c-1]) × (P[r+1][c] - P[r-1][c]),
+//   tj. sousední vertikální úhly v linii × sousední linie. Žádné k-NN.
+//   Orientace k senzoru (n · (P - sensor) < 0), délka 1, kvantizace na int8.
+// • Řádek se zpracuje najednou: tři sousední řádky se rozbalí do SoA polí
+//   (x, y, z, platnost), křížový součin + normalizace je smyčka bez větvení,
+//   kterou kompilátor převede na SIMD (stejně jako v CorridorFinder).
+// • Počítá se jen na vyžádání: klient si předplatí výřez range image
+//   (horizontální úhel LiDARu = řádek, viz RangeImage) na kSubscriptionRevs
+//   otáček. onRevolution() přepočítá jen předplacené řádky, které se od
+//   minulého výpočtu změnily (jiný stamp řádku) → cache na otáčku.
+// • Výstup: NormalSet – předplacené řádky s normálami (int8 ×127, 0,0,0 =
+//   neplatná).
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "range_image.hpp"
+
+struct NormalSet
+{
+    struct Row {
+        std::uint16_t row;
+        float         h_angle;              // [rad], horizontální úhel LiDARu
+        std::uint16_t n;                    // počet sloupců
+        std::vector<std::int8_t> normals;   // 3 × n: nx, ny, nz (rámec robota, ×127)
+    };
+
+    std::uint64_t    rev = 0;
+    std::vector<Row> rows;
+
+    // Řádek r ve výřezu [r0, r1] (s přetečením přes 2π)?
+    static bool inRange(int r, int r0, int r1)
+    {
+        return r0 <= r1 ? (r >= r0 && r <= r1) : (r >= r0 || r <= r1);
+    }
+};
+
+class NormalEstimator
+{
+public:
+    static constexpr int kRows = RangeImage::kRows;
+    static constexpr int kCols = RangeImage::kCols;
+    static constexpr std::uint32_t kSubscriptionRevs = 50;   // ~ pár sekund
+    static constexpr float kMaxEdgeCm = 30.0f;                // delší hrana = nespojitost
+    static constexpr double kMaxRowDt = 0.2;                  // [s] sousední řádek starší = neplatný
+
+    explicit NormalEstimator(const Eigen::Vector3f &sensor_cm = Eigen::Vector3f::Zero())
+        : sensor_(sensor_cm),
+          cache_(static_cast<std::size_t>(kRows) * kCols * 3, 0),
+          cache_stamp_(kRows, -1.0)
+    {
+        for (auto &s : subscribed_until_) s.store(0, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        std::fill(cache_stamp_.begin(), cache_stamp_.end(), -1.0);
+    }
+
+    // Výřez horizontálních úhlů [deg] → řádky [r0, r1] (celý kruh = všechny).
+    static void rowRange(float from_deg, float to_deg, int &r0, int &r1)
+    {
+        constexpr float kDeg = static_cast<float>(M_PI) / 180.0f;
+        r0 = RangeImage::rowOf(from_deg * kDeg);
+        r1 = std::fabs(to_deg - from_deg) >= 360.0f ? RangeImage::rowPrev(r0)
+                                                     : RangeImage::rowOf(to_deg * kDeg);
+    }
+
+    // Předplatné výřezu horizontálních úhlů [deg] (libovolné vlákno).
+    void subscribe(float from_deg, float to_deg, std::uint64_t rev)
+    {
+        int r0 = 0, r1 = 0;
+        rowRange(from_deg, to_deg, r0, r1);
+        const std::uint32_t until = static_cast<std::uint32_t>(rev) + kSubscriptionRevs;
+        for (int r = r0;; r = RangeImage::rowNext(r)) {
+            subscribed_until_[r].store(until, std::memory_order_relaxed);
+            if (r == r1) break;
+        }
+    }
+
+    // Jednou za otáčku (vlákno, které zapisuje do range image): přepočet
+    // předplacených změněných řádků a sestavení výstupu.
+    std::size_t update(const RangeImage &img, std::uint64_t rev, NormalSet &out)
+    {
+        std::size_t computed = 0;
+        out.rev = rev;
+        out.rows.clear();
+        for (int r = 0; r < kRows; ++r) {
+            if (subscribed_until_[r].load(std::memory_order_relaxed) < rev) continue;
+            const RangeImage::Row &row = img.row(r);
+            if (row.stamp < 0.0 || row.n < 3) continue;
+
+            std::int8_t *dst = &cache_[static_cast<std::size_t>(r) * kCols * 3];
+            if (cache_stamp_[r] != row.stamp) {
+                computeRow(img, r, dst);
+                cache_stamp_[r] = row.stamp;
+                ++computed;
+            }
+            NormalSet::Row o;
+            o.row = static_cast<std::uint16_t>(r);
+            o.h_angle = row.h_angle;
+            o.n = row.n;
+            o.normals.assign(dst, dst + 3 * row.n);
+            out.rows.push_back(std::move(o));
+        }
+        return computed;
+    }
+
+    // Normály jednoho řádku do dst (3 × kCols int8).
+    void computeRow(const RangeImage &img, int r, std::int8_t *dst) const
+    {
+        alignas(32) float x0[kCols], y0[kCols], z0[kCols];   // řádek r
+        alignas(32) float xp[kCols], yp[kCols], zp[kCols];   // r - 1
+        alignas(32) float xn[kCols], yn[kCols], zn[kCols];   // r + 1
+        alignas(32) float v0[kCols], vp[kCols], vn[kCols];   // platnost 0/1
+
+        const int n = img.row(r).n;
+        const double t = img.row(r).stamp;
+        const int rp = RangeImage::rowPrev(r), rn = RangeImage::rowNext(r);
+        // sousední řádek mohl mít v této otáčce méně bodů – buňky za jeho
+        // Row::n jsou z dřívější otáčky → neplatné
+        load(img.rowData(r), n, n, x0, y0, z0, v0, true);
+        load(img.rowData(rp), n, std::min(n, static_cast<int>(img.row(rp).n)), xp, yp, zp, vp,
+             std::fabs(img.row(rp).stamp - t) < kMaxRowDt);
+        load(img.rowData(rn), n, std::min(n, static_cast<int>(img.row(rn).n)), xn, yn, zn, vn,
+             std::fabs(img.row(rn).stamp - t) < kMaxRowDt);
+
+        alignas(32) float nx[kCols], ny[kCols], nz[kCols];
+        const float sx = sensor_.x(), sy = sensor_.y(), sz = sensor_.z();
+        const float max_e2 = kMaxEdgeCm * kMaxEdgeCm;
+
+        // vektorizovatelná část: křížový součin, orientace, normalizace
+        for (int c = 1; c < n - 1; ++c) {
+            const float ax = x0[c + 1] - x0[c - 1];
+            const float ay = y0[c + 1] - y0[c - 1];
+            const float az = z0[c + 1] - z0[c - 1];
+            const float bx = xn[c] - xp[c];
+            const float by = yn[c] - yp[c];
+            const float bz = zn[c] - zp[c];
+
+            float cx = ay * bz - az * by;
+            float cy = az * bx - ax * bz;
+            float cz = ax * by - ay * bx;
+
+            const float dot = cx * (x0[c] - sx) + cy * (y0[c] - sy) + cz * (z0[c] - sz);
+            const float sgn = dot > 0.0f ? -1.0f : 1.0f;
+            const float len2 = std::max(cx * cx + cy * cy + cz * cz, 1e-6f);
+
+            // platnost bez větvení (násobení 0/1 masek → blend v SIMD)
+            const float ok = v0[c] * v0[c - 1] * v0[c + 1] * vp[c] * vn[c] *
+                             (ax * ax + ay * ay + az * az < 4.0f * max_e2 ? 1.0f : 0.0f) *
+                             (bx * bx + by * by + bz * bz < 4.0f * max_e2 ? 1.0f : 0.0f) *
+                             (len2 > 1e-6f ? 1.0f : 0.0f);
+            const float inv = ok * sgn * 127.0f / std::sqrt(len2);
+            nx[c] = cx * inv;
+            ny[c] = cy * inv;
+            nz[c] = cz * inv;
+        }
+
+        dst[0] = dst[1] = dst[2] = 0;
+        for (int c = 1; c < n - 1; ++c) {
+            dst[3 * c + 0] = static_cast<std::int8_t>(nx[c] + (nx[c] < 0.0f ? -0.5f : 0.5f));
+            dst[3 * c + 1] = static_cast<std::int8_t>(ny[c] + (ny[c] < 0.0f ? -0.5f : 0.5f));
+            dst[3 * c + 2] = static_cast<std::int8_t>(nz[c] + (nz[c] < 0.0f ? -0.5f : 0.5f));
+        }
+        if (n > 1) {
+            dst[3 * (n - 1) + 0] = dst[3 * (n - 1) + 1] = dst[3 * (n - 1) + 2] = 0;
+        }
+    }
+
+private:
+    // n sloupců do SoA polí; platné jen prvních valid_n (Row::n řádku).
+    static void load(const RangeImage::Cell *cells, int n, int valid_n,
+                     float *x, float *y, float *z, float *v, bool fresh)
+    {
+        for (int c = 0; c < n; ++c) {
+            const RangeImage::Cell &cell = cells[c];
+            const bool ok = fresh && c < valid_n && cell.valid();
+            x[c] = ok ? cell.x : 0.0f;
+            y[c] = ok ? cell.y : 0.0f;
+            z[c] = ok ? cell.z : 0.0f;
+            v[c] = ok ? 1.0f : 0.0f;
+        }
+    }
+
+    Eigen::Vector3f                 sensor_;        // poloha LiDARu v rámci robota [cm]
+    std::vector<std::int8_t>        cache_;         // kRows × kCols × 3
+    std::vector<double>             cache_stamp_;   // stamp řádku, pro který cache platí
+    std::array<std::atomic<std::uint32_t>, kRows> subscribed_until_;
+};
@@ -1,5 +1,5 @@
 from fastapi import APIRouter
-from fastapi.responses import JSONResponse, FileResponse
+from fastapi.responses import JSONResponse, FileResponse, StreamingResponse
 import asyncio
 import socket
 from sse_starlette.sse import EventSourceResponse
@@ -14,6 +14,10 @@ LIDAR_CMD_MAP = {
     "start"     : "START",
     "stop"      : "STOP",
     "distance"  : "DISTANCE",
+    "coridors"  : "CORIDORS",
+    "objects"   : "OBJECTS",
+    "tracks"    : "TRACKS",
+    "trigger"   : "TRIGGER",
 }
 
 def send_lidar(cmd: str, timeout=150) -> str:
@@ -49,3 +53,26 @@ async def lidar_stream():
             print("🛑 SSE klient odpojen")
             return
     return EventSourceResponse(event_generator())
+
+@router.get("/lidar_cloud")
+async def lidar_cloud(voxel: int = 10):
+    # binární rámce L2CF (cloud_stream.hpp) se jen přeposílají, parsuje prohlížeč
+    async def relay():
+        reader, writer = await asyncio.open_connection(LIDAR_HOST, LIDAR_PORT)
+        try:
+            writer.write(f"SUBSCRIBE CLOUD {voxel}\n".encode())
+            await writer.drain()
+            line = await reader.readline()
+            if not line.startswith(b"OK"):
+                print("❌ SUBSCRIBE CLOUD:", line.decode(errors="ignore").strip())
+                return
+            while True:
+                chunk = await reader.read(65536)
+                if not chunk:
+                    break
+                yield chunk
+        except asyncio.CancelledError:
+            print("🛑 Cloud klient odpojen")
+        finally:
+            writer.close()
+    return StreamingResponse(relay(), media_type="application/octet-stream")